@@ -5,6 +5,8 @@
 #include "math/num.hpp"
 
 #include <algorithm>
+#include <cassert>
+#include <vector>
 
 
 namespace iptsd::alg::border {
@@ -17,8 +19,8 @@ struct Mirror {
 template<class T>
 constexpr auto Mirror::value(Image<T> const& img, index2_t const& i) -> T
 {
-    index_t const x = i.x >= 0 ? (i.x < img.shape().x ? i.x : 2 * img.shape().x - i.x - 1) : (-1 - i.x);
-    index_t const y = i.y >= 0 ? (i.y < img.shape().y ? i.y : 2 * img.shape().y - i.y - 1) : (-1 - i.y);
+    index_t const x = i.x >= 0 ? (i.x < img.size().x ? i.x : 2 * img.size().x - i.x - 1) : (-1 - i.x);
+    index_t const y = i.y >= 0 ? (i.y < img.size().y ? i.y : 2 * img.size().y - i.y - 1) : (-1 - i.y);
 
     return img[{x, y}];
 }
@@ -32,9 +34,9 @@ struct MirrorX {
 template<class T>
 constexpr auto MirrorX::value(Image<T> const& img, index2_t const& i) -> T
 {
-    index_t const x = i.x >= 0 ? (i.x < img.shape().x ? i.x : 2 * img.shape().x - i.x - 1) : (-1 - i.x);
+    index_t const x = i.x >= 0 ? (i.x < img.size().x ? i.x : 2 * img.size().x - i.x - 1) : (-1 - i.x);
 
-    return i.y >= 0 && i.y < img.shape().y ? img[{x, i.y}] : math::num<T>::zero;
+    return i.y >= 0 && i.y < img.size().y ? img[{x, i.y}] : math::num<T>::zero;
 }
 
 
@@ -46,9 +48,9 @@ struct MirrorY {
 template<class T>
 constexpr auto MirrorY::value(Image<T> const& img, index2_t const& i) -> T
 {
-    index_t const y = i.y >= 0 ? (i.y < img.shape().y ? i.y : 2 * img.shape().y - i.y - 1) : (-1 - i.y);
+    index_t const y = i.y >= 0 ? (i.y < img.size().y ? i.y : 2 * img.size().y - i.y - 1) : (-1 - i.y);
 
-    return i.x >= 0 && i.x < img.shape().x ? img[{i.x, y}] : math::num<T>::zero;
+    return i.x >= 0 && i.x < img.size().x ? img[{i.x, y}] : math::num<T>::zero;
 }
 
 
@@ -60,8 +62,8 @@ struct Extend {
 template<class T>
 constexpr auto Extend::value(Image<T> const& img, index2_t const& i) -> T
 {
-    index_t const x = std::clamp(i.x, 0, img.shape().x - 1);
-    index_t const y = std::clamp(i.y, 0, img.shape().y - 1);
+    index_t const x = std::clamp(i.x, 0, img.size().x - 1);
+    index_t const y = std::clamp(i.y, 0, img.size().y - 1);
 
     return img[{x, y}];
 }
@@ -75,8 +77,120 @@ struct Zero {
 template<class T>
 constexpr auto Zero::value(Image<T> const& img, index2_t const& i) -> T
 {
-    return i.x >= 0 && i.x < img.shape().x && i.y >= 0 && i.y < img.shape().y ?
+    return i.x >= 0 && i.x < img.size().x && i.y >= 0 && i.y < img.size().y ?
         img[{i.x, i.y}] : math::num<T>::zero;
 }
 
+
+
+/**
+ * RowWindow - Sliding window over the rows of an image, padded by a border.
+ * @B: Border policy used for all pixels outside of the image.
+ * @R: Radius of the window, i.e. number of pixels on each side.
+ *
+ * Buffers rows y - R to y + R of the input, each extended by R pixels on both
+ * sides, with rows and pixels outside of the image taken from the border
+ * policy. Kernels of radius R can thus compute each output row with a single
+ * interior loop, without special-casing the border of the image. Each input
+ * row is copied once per image, as the window only moves forward.
+ */
+template<class B, index_t R, class T>
+class RowWindow {
+public:
+    explicit RowWindow(Image<T> const& img);
+
+    RowWindow(RowWindow const&) = delete;
+    auto operator= (RowWindow const&) -> RowWindow& = delete;
+
+    void load(index_t y);
+
+    auto row(index_t dy) const -> T const*;
+
+private:
+    static constexpr index_t n_rows = 2 * R + 1;
+
+    // row buffer on the stack, only fall back to the heap for very wide images
+    static constexpr index_t stack_len = 16384 / sizeof(T);
+
+    auto slot(index_t y) -> T*;
+    void fill(index_t y);
+
+    Image<T> const& m_img;
+    index_t m_y;
+    index_t m_width;
+    T m_stack[stack_len];
+    std::vector<T> m_heap;
+    T* m_buf;
+};
+
+template<class B, index_t R, class T>
+RowWindow<B, R, T>::RowWindow(Image<T> const& img)
+    : m_img{img}
+    , m_y{-1}
+    , m_width{img.size().x + 2 * R}
+    , m_heap{}
+    , m_buf{m_stack}
+{
+    if (n_rows * m_width > stack_len) {
+        m_heap.resize(n_rows * m_width);
+        m_buf = m_heap.data();
+    }
+}
+
+/*
+ * Move the window to row y. Must be called for y = 0, 1, 2, ... in order.
+ */
+template<class B, index_t R, class T>
+void RowWindow<B, R, T>::load(index_t y)
+{
+    assert(y == m_y + 1);
+
+    if (m_y < 0) {
+        for (index_t j = -R; j < R; ++j) {
+            this->fill(j);
+        }
+    }
+
+    this->fill(y + R);
+    m_y = y;
+}
+
+/*
+ * Pointer to pixel x = 0 of row y + dy, with dy in [-R, R]. Valid for x in
+ * [-R, size.x + R).
+ */
+template<class B, index_t R, class T>
+inline auto RowWindow<B, R, T>::row(index_t dy) const -> T const*
+{
+    return m_buf + ((m_y + dy + R) % n_rows) * m_width + R;
+}
+
+template<class B, index_t R, class T>
+inline auto RowWindow<B, R, T>::slot(index_t y) -> T*
+{
+    return m_buf + ((y + R) % n_rows) * m_width + R;
+}
+
+template<class B, index_t R, class T>
+void RowWindow<B, R, T>::fill(index_t y)
+{
+    auto const size = m_img.size();
+    T* const dst = this->slot(y);
+
+    if (y < 0 || y >= size.y) {
+        for (index_t x = -R; x < size.x + R; ++x) {
+            dst[x] = B::value(m_img, { x, y });
+        }
+
+        return;
+    }
+
+    std::copy(m_img.row(y), m_img.row(y) + size.x, dst);
+
+    for (index_t x = 1; x <= R; ++x) {
+        dst[-x] = B::value(m_img, { -x, y });
+        dst[size.x - 1 + x] = B::value(m_img, { size.x - 1 + x, y });
+    }
+}
+
 } /* namespace iptsd::alg::border */
@@ -7,12 +7,22 @@
 #include "container/image.hpp"
 #include "container/kernel.hpp"
 #include "container/ops.hpp"
+#include "container/tensor_image.hpp"
 
 #include "math/num.hpp"
+#include "math/mat2.hpp"
 #include "math/vec2.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
 #include "algorithm/opt/convolution.3x3-extend.hpp"
 #include "algorithm/opt/convolution.5x5-extend.hpp"
+#include "algorithm/opt/convolution.5x5-extend.simd.hpp"
+#include "algorithm/opt/convolution.separable-extend.hpp"
 
 
 namespace iptsd::alg {
@@ -86,6 +96,36 @@ auto gaussian(T sigma) -> Kernel<T, Nx, Ny>
     return k;
 }
 
+template<class T, index_t Nx, index_t Ny>
+auto gaussian_separable(T sigma) -> SeparableKernel<T, Nx, Ny>
+{
+    static_assert(Nx % 2 == 1);
+    static_assert(Ny % 2 == 1);
+
+    auto const gauss1d = [&](auto& k, index_t n) {
+        T sum = static_cast<T>(0.0);
+
+        for (index_t i = 0; i < n; i++) {
+            auto const x = static_cast<T>(i - (n - 1) / 2) / sigma;
+            auto const v = std::exp(-static_cast<T>(0.5) * x * x);
+
+            k[i] = v;
+            sum += v;
+        }
+
+        container::ops::transform(k, [&](auto const& x) {
+            return x / sum;
+        });
+    };
+
+    auto k = SeparableKernel<T, Nx, Ny>{};
+
+    gauss1d(k.x, Nx);
+    gauss1d(k.y, Ny);
+
+    return k;
+}
+
 } /* namespace kernels */
 
 
@@ -97,8 +137,8 @@ void conv_generic(Image<T>& out, Image<T> const& in, Kernel<S, Nx, Ny> const& k)
     index_t const dx = (Nx - 1) / 2;
     index_t const dy = (Ny - 1) / 2;
 
-    for (index_t cy = 0; cy < in.shape().y; ++cy) {
-        for (index_t cx = 0; cx < in.shape().x; ++cx) {
+    for (index_t cy = 0; cy < in.size().y; ++cy) {
+        for (index_t cx = 0; cx < in.size().x; ++cx) {
             out[{cx, cy}] = math::num<T>::zero;
 
             for (index_t iy = 0; iy < Ny; ++iy) {
@@ -118,7 +158,9 @@ template<typename B=border::Extend, typename T, typename S, index_t Nx, index_t
 void convolve(Image<T>& out, Image<T> const& in, Kernel<S, Nx, Ny> const& k)
 {
     // workaround for partial function template specialization
-    if constexpr (Nx == 5 && Ny == 5 && std::is_same_v<B, border::Extend>) {
+    if constexpr (Nx == 5 && Ny == 5 && std::is_same_v<B, border::Extend> && conv::impl::simd_5x5_extend_v<T, S>) {
+        conv::impl::conv_5x5_extend_simd<T, S>(out, in, k);
+    } else if constexpr (Nx == 5 && Ny == 5 && std::is_same_v<B, border::Extend>) {
         conv::impl::conv_5x5_extend<T, S>(out, in, k);
     } else if constexpr (Nx == 3 && Ny == 3 && std::is_same_v<B, border::Extend>) {
         conv::impl::conv_3x3_extend<T, S>(out, in, k);
@@ -127,4 +169,33 @@ void convolve(Image<T>& out, Image<T> const& in, Kernel<S, Nx, Ny> const& k)
     }
 }
 
+template<typename B=border::Extend, typename T, typename S, index_t Nx, index_t Ny>
+void convolve(Image<T>& out, Image<T> const& in, SeparableKernel<S, Nx, Ny> const& k)
+{
+    static_assert(std::is_same_v<B, border::Extend>, "only extend border supported for separable kernels");
+
+    conv::impl::conv_separable_extend<T, S, Nx, Ny>(out, in, k);
+}
+
+template<typename B=border::Extend, typename T, typename S, index_t Nx, index_t Ny>
+void convolve(TensorImage<T>& out, TensorImage<T> const& in, SeparableKernel<S, Nx, Ny> const& k)
+{
+    static_assert(std::is_same_v<B, border::Extend>, "only extend border supported for separable kernels");
+
+    conv::impl::conv_separable_extend<T, S, Nx, Ny>(out, in, k);
+}
+
+/*
+ * Convolve and apply row_op(row, n) to each output row right after it has
+ * been computed, where row points to the n underlying scalars of that row.
+ * Allows fusing per-pixel post-processing into the convolution sweep.
+ */
+template<typename B=border::Extend, typename T, typename S, index_t Nx, index_t Ny, typename F>
+void convolve(Image<T>& out, Image<T> const& in, SeparableKernel<S, Nx, Ny> const& k, F row_op)
+{
+    static_assert(std::is_same_v<B, border::Extend>, "only extend border supported for separable kernels");
+
+    conv::impl::conv_separable_extend<T, S, Nx, Ny>(out, in, k, row_op);
+}
+
 } /* namespace iptsd::alg */
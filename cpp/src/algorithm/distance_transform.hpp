@@ -3,8 +3,16 @@
 #include "types.hpp"
 #include "container/image.hpp"
 
-#include <queue>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <limits>
 #include <numeric>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 namespace iptsd::alg {
@@ -53,6 +61,195 @@ auto operator> (struct QItem<T> const& a, struct QItem<T> const& b) noexcept ->
 }
 
 
+/**
+ * RadixQueue - Monotone min-priority queue for non-negative costs.
+ *
+ * Radix heap (Ahuja, Mehlhorn, Orlin, Tarjan, "Faster algorithms for the
+ * shortest path problem", J. ACM 37 (1990), pp. 213-223) operating on the bit
+ * representation of the cost. For non-negative IEEE floats, the bit pattern
+ * interpreted as unsigned integer is monotone in the value, so we can use it
+ * directly as key.
+ *
+ * Items are distributed into buckets by the highest bit in which their key
+ * differs from the last extracted minimum. Pushing is O(1), and each item is
+ * moved at most once per bit over its lifetime, independent of the queue
+ * size. In contrast to a binary heap, this requires that no item with a
+ * smaller cost than the last extracted minimum is pushed. This holds for the
+ * distance transform, as costs of neighbors are never negative. The
+ * monotonicity constraint is reset once the queue runs empty.
+ *
+ * Provides the subset of the std::priority_queue interface used by
+ * weighted_distance_transform(), with the exception that top() is not const
+ * as it lazily refills the minimum bucket.
+ */
+template<typename T>
+class RadixQueue {
+public:
+    using value_type = QItem<T>;
+    using key_type   = std::conditional_t<sizeof(T) <= 4, u32, u64>;
+
+    static_assert(std::is_floating_point_v<T> || std::is_unsigned_v<T>);
+
+public:
+    RadixQueue(std::size_t capacity=0);
+
+    auto empty() const -> bool;
+    auto size() const -> std::size_t;
+
+    auto top() -> value_type const&;
+
+    void push(value_type const& item);
+    void pop();
+
+    void clear();
+
+private:
+    static constexpr index_t n_buckets = sizeof(key_type) * 8 + 1;
+
+    static auto key(T cost) -> key_type;
+    auto bucket(key_type key) const -> index_t;
+
+    void refill();
+
+private:
+    std::array<std::vector<value_type>, n_buckets> m_buckets;
+    key_type    m_last;
+    std::size_t m_size;
+};
+
+
+template<typename T>
+inline RadixQueue<T>::RadixQueue(std::size_t capacity)
+    : m_buckets{}
+    , m_last{0}
+    , m_size{0}
+{
+    // most of the traffic goes through the lower buckets, reserve these
+    for (auto& b : m_buckets) {
+        b.reserve(capacity / 4);
+    }
+}
+
+template<typename T>
+inline auto RadixQueue<T>::empty() const -> bool
+{
+    return m_size == 0;
+}
+
+template<typename T>
+inline auto RadixQueue<T>::size() const -> std::size_t
+{
+    return m_size;
+}
+
+template<typename T>
+inline auto RadixQueue<T>::top() -> value_type const&
+{
+    assert(m_size > 0);
+
+    if (m_buckets[0].empty()) {
+        refill();
+    }
+
+    return m_buckets[0].back();
+}
+
+template<typename T>
+inline void RadixQueue<T>::push(value_type const& item)
+{
+    auto const k = key(item.cost);
+
+    assert(k >= m_last);
+
+    m_buckets[bucket(k)].push_back(item);
+    m_size += 1;
+}
+
+template<typename T>
+inline void RadixQueue<T>::pop()
+{
+    assert(m_size > 0);
+
+    if (m_buckets[0].empty()) {
+        refill();
+    }
+
+    m_buckets[0].pop_back();
+    m_size -= 1;
+
+    // nothing left that we need to be monotone to, reset
+    if (m_size == 0) {
+        m_last = 0;
+    }
+}
+
+template<typename T>
+inline void RadixQueue<T>::clear()
+{
+    for (auto& b : m_buckets) {
+        b.clear();
+    }
+
+    m_last = 0;
+    m_size = 0;
+}
+
+template<typename T>
+inline auto RadixQueue<T>::key(T cost) -> key_type
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        static_assert(sizeof(T) == sizeof(key_type));
+
+        auto k = key_type{};
+        std::memcpy(&k, &cost, sizeof(k));
+
+        // map -0.0 to +0.0 by clearing the sign bit, as adding zero may be
+        // optimized away with -ffast-math, note: requires cost >= 0
+        return k & ~(key_type{1} << (sizeof(key_type) * 8 - 1));
+    } else {
+        return static_cast<key_type>(cost);
+    }
+}
+
+template<typename T>
+inline auto RadixQueue<T>::bucket(key_type k) const -> index_t
+{
+    auto const x = k ^ m_last;
+
+    if (x == 0) {
+        return 0;
+    }
+
+    if constexpr (sizeof(key_type) <= sizeof(unsigned int)) {
+        return sizeof(unsigned int) * 8 - __builtin_clz(x);
+    } else {
+        return sizeof(unsigned long long) * 8 - __builtin_clzll(x);
+    }
+}
+
+template<typename T>
+void RadixQueue<T>::refill()
+{
+    // find first non-empty bucket
+    index_t i = 1;
+    while (m_buckets[i].empty()) {
+        ++i;
+    }
+
+    auto& src = m_buckets[i];
+
+    // new minimum becomes the reference for bucket indices
+    m_last = key(std::min_element(src.begin(), src.end())->cost);
+
+    // redistribute: all items of bucket i end up in buckets below i
+    for (auto const& item : src) {
+        m_buckets[bucket(key(item.cost))].push_back(item);
+    }
+
+    src.clear();
+}
+
+
 namespace impl {
 
 template<typename T>
@@ -93,6 +290,34 @@ inline void evaluate(Image<T>& out, Q& queue, B& bin, M& mask, C& cost, index_t
     }
 }
 
+
+template<int N>
+inline constexpr std::array<index2_t, N> neighbors {};
+
+template<>
+inline constexpr std::array<index2_t, 4> neighbors<4> {{
+    { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 },
+}};
+
+template<>
+inline constexpr std::array<index2_t, 8> neighbors<8> {{
+    { -1, 0 }, { 1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 1 }, { 0, 1 }, { 1, 1 },
+}};
+
+/*
+ * The dual-source transform shares one queue for both fronts. We encode the
+ * front (0 or 1) in the lowest bit of the queue index.
+ */
+inline constexpr auto dual_encode(index_t i, index_t label) -> index_t
+{
+    return (i << 1) | label;
+}
+
+inline constexpr auto dual_decode(index_t v) -> std::pair<index_t, index_t>
+{
+    return { v >> 1, v & 1 };
+}
+
 } /* namespace impl */
 } /* namespace wdt */
 
@@ -255,8 +480,8 @@ void weighted_distance_transform(Image<T>& out, F& bin, M& mask, C& cost, Q& q,
         ++i;
 
         // 0 < x < n - 1
-        auto const limit = i + out.size().x - 2;
-        for (; i < limit; ++i) {
+        auto const row_end = i + out.size().x - 2;
+        for (; i < row_end; ++i) {
             // if this is a foreground pixel, set it to zero and skip the rest
             if (is_foreground(bin, i)) {
                 out[i] = static_cast<T>(0);
@@ -492,4 +717,128 @@ void weighted_distance_transform(Image<T>& out, F& bin, M& mask, C& cost, Q& q,
     }
 }
 
+
+/**
+ * weighted_distance_transform_dual() - Distance transform for two sources at once.
+ * @out_a: Output for the distances to the foreground of @bin_a.
+ * @out_b: Output for the distances to the foreground of @bin_b.
+ * @bin_a: Foreground predicate of the first source.
+ * @bin_b: Foreground predicate of the second source.
+ * @mask:  Predicate for pixels that should be evaluated.
+ * @cost:  Cost functor, evaluated as cost(index, direction).
+ * @q:     Priority queue for wdt::QItem<T>, must be empty.
+ * @limit: Maximum distance to propagate.
+ *
+ * Equivalent to calling weighted_distance_transform() once for each source
+ * with the same mask and cost, but propagates both fronts in a single queue
+ * sweep. Both sources are seeded in a single pass over the image, sharing
+ * foreground tests and cost evaluations of the seeding step. The queue is
+ * drained only once for both fronts.
+ */
+template<int N=8, typename T, typename Fa, typename Fb, typename M, typename C, typename Q>
+void weighted_distance_transform_dual(Image<T>& out_a, Image<T>& out_b, Fa& bin_a, Fb& bin_b,
+                                      M& mask, C& cost, Q& q,
+                                      T limit=std::numeric_limits<T>::max())
+{
+    using wdt::impl::dual_decode;
+    using wdt::impl::dual_encode;
+    using wdt::impl::get_cost;
+    using wdt::impl::is_foreground;
+    using wdt::impl::is_masked;
+
+    static_assert(N == 4 || N == 8);
+
+    auto const& nbs = wdt::impl::neighbors<N>;
+    auto const size = out_a.size();
+    auto const max = std::numeric_limits<T>::max();
+
+    assert(out_a.size() == out_b.size());
+
+    // step 1: initialize outputs, queue all non-masked pixels next to a source
+    for (index_t y = 0, i = 0; y < size.y; ++y) {
+        for (index_t x = 0; x < size.x; ++x, ++i) {
+            auto const fg_a = is_foreground(bin_a, i);
+            auto const fg_b = is_foreground(bin_b, i);
+
+            out_a[i] = fg_a ? static_cast<T>(0) : max;
+            out_b[i] = fg_b ? static_cast<T>(0) : max;
+
+            if ((fg_a && fg_b) || is_masked(mask, i))
+                continue;
+
+            // compute minimum cost to any neighboring foreground pixel, per source
+            auto c_a = max;
+            auto c_b = max;
+
+            for (auto const d : nbs) {
+                if (x + d.x < 0 || x + d.x >= size.x || y + d.y < 0 || y + d.y >= size.y)
+                    continue;
+
+                auto const n = i + d.y * out_a.stride() + d.x;
+
+                auto const src_a = !fg_a && is_foreground(bin_a, n);
+                auto const src_b = !fg_b && is_foreground(bin_b, n);
+
+                if (!src_a && !src_b)
+                    continue;
+
+                auto const c = get_cost<T>(cost, n, { -d.x, -d.y });
+
+                if (src_a) {
+                    c_a = std::min(c_a, c);
+                }
+
+                if (src_b) {
+                    c_b = std::min(c_b, c);
+                }
+            }
+
+            if (c_a < limit) {
+                q.push({ dual_encode(i, 0), c_a });
+            }
+
+            if (c_b < limit) {
+                q.push({ dual_encode(i, 1), c_b });
+            }
+        }
+    }
+
+    // step 2: while queue is not empty, get next pixel, write down cost, and add neighbors
+    while (!q.empty()) {
+        // get next pixel and remove it from queue
+        wdt::QItem<T> pixel = q.top();
+        q.pop();
+
+        auto const [idx, label] = dual_decode(pixel.idx);
+        auto& out = label == 0 ? out_a : out_b;
+
+        // check if someone has been here before; if so, skip this one
+        if (out[idx] <= pixel.cost)
+            continue;
+
+        // no one has been here before, so we're guaranteed to be on the lowes cost path
+        out[idx] = pixel.cost;
+
+        // evaluate neighbors
+        auto const [x, y] = Image<T>::unravel(size, idx);
+
+        for (auto const d : nbs) {
+            if (x + d.x < 0 || x + d.x >= size.x || y + d.y < 0 || y + d.y >= size.y)
+                continue;
+
+            auto const n = idx + d.y * out.stride() + d.x;
+
+            auto const fg = label == 0 ? is_foreground(bin_a, n) : is_foreground(bin_b, n);
+            if (fg || is_masked(mask, n))
+                continue;
+
+            auto const c = out[idx] + get_cost<T>(cost, idx, d);
+
+            if (c < out[n] && c < limit) {
+                q.push({ dual_encode(n, label), c });
+            }
+        }
+    }
+}
+
 } /* namespace iptsd::alg */
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "types.hpp"
+
+#include "container/image.hpp"
+#include "container/tensor_image.hpp"
+
+#include "math/num.hpp"
+#include "math/mat2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg {
+namespace eigen2::impl {
+
+/*
+ * Quantities derived from the eigenvalues, as used by the touch processor.
+ */
+template<typename T>
+inline auto pos_sum(T ev1, T ev2) -> T
+{
+    return std::max(ev1, math::num<T>::zero) + std::max(ev2, math::num<T>::zero);
+}
+
+template<typename T>
+inline auto coherence(T ev1, T ev2) -> T
+{
+    return ev1 + ev2 != math::num<T>::zero ? (ev1 - ev2) / (ev1 + ev2) : math::num<T>::one;
+}
+
+
+#if defined(__AVX2__)
+
+/*
+ * Load 8 consecutive Mat2s<f32> and transpose them into one register per
+ * component.
+ */
+inline void load_3(f32 const* p, __m256& xx, __m256& xy, __m256& yy)
+{
+    auto const a = _mm256_loadu_ps(p);
+    auto const b = _mm256_loadu_ps(p + 8);
+    auto const c = _mm256_loadu_ps(p + 16);
+
+    auto const tx = _mm256_blend_ps(_mm256_blend_ps(a, b, 0b10010010), c, 0b00100100);
+    auto const ty = _mm256_blend_ps(_mm256_blend_ps(a, b, 0b00100100), c, 0b01001001);
+    auto const tz = _mm256_blend_ps(_mm256_blend_ps(a, b, 0b01001001), c, 0b10010010);
+
+    xx = _mm256_permutevar8x32_ps(tx, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+    xy = _mm256_permutevar8x32_ps(ty, _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+    yy = _mm256_permutevar8x32_ps(tz, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+}
+
+/*
+ * Load tensor K of 8 consecutive std::array<Mat2s<f32>, 2>. These are 16
+ * interleaved Mat2s, so transpose them and select the even or odd lanes.
+ */
+template<index_t K>
+inline void load_6(f32 const* p, __m256& xx, __m256& xy, __m256& yy)
+{
+    __m256 a[3];
+    __m256 b[3];
+
+    load_3(p,      a[0], a[1], a[2]);
+    load_3(p + 24, b[0], b[1], b[2]);
+
+    auto const idx = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    for (int c = 0; c < 3; ++c) {
+        a[c] = _mm256_permutevar8x32_ps(a[c], idx);
+        b[c] = _mm256_permutevar8x32_ps(b[c], idx);
+    }
+
+    constexpr int sel = K == 0 ? 0x20 : 0x31;
+
+    xx = _mm256_permute2f128_ps(a[0], b[0], sel);
+    xy = _mm256_permute2f128_ps(a[1], b[1], sel);
+    yy = _mm256_permute2f128_ps(a[2], b[2], sel);
+}
+
+/*
+ * Branch-free version of Mat2s::eigenvalues() for 8 matrices, with the same
+ * ordering of the results.
+ */
+inline void eigenvalues_8(__m256 xx, __m256 xy, __m256 yy, __m256& ev1, __m256& ev2)
+{
+    auto const sign = _mm256_set1_ps(-0.0f);
+    auto const half = _mm256_set1_ps(0.5f);
+    auto const four = _mm256_set1_ps(4.0f);
+    auto const eps  = _mm256_set1_ps(math::num<f32>::eps);
+
+    auto const tr  = _mm256_add_ps(xx, yy);
+    auto const det = _mm256_sub_ps(_mm256_mul_ps(xx, yy), _mm256_mul_ps(xy, xy));
+
+    // tr^2 - 4 det, written such that it cannot become negative
+    auto const d = _mm256_sub_ps(xx, yy);
+    auto const q = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(d, d), _mm256_mul_ps(four, _mm256_mul_ps(xy, xy))));
+
+    // r1 = (tr + copysign(q, tr)) / 2, r2 = det / r1
+    auto const qs = _mm256_or_ps(q, _mm256_and_ps(tr, sign));
+    auto const r1 = _mm256_mul_ps(_mm256_add_ps(tr, qs), half);
+    auto const r2 = _mm256_div_ps(det, r1);
+
+    // det ~ 0: roots are tr and zero
+    auto const singular = _mm256_cmp_ps(_mm256_andnot_ps(sign, det), eps, _CMP_LE_OQ);
+
+    ev1 = _mm256_blendv_ps(r1, tr, singular);
+    ev2 = _mm256_blendv_ps(r2, _mm256_setzero_ps(), singular);
+}
+
+inline auto pos_sum_8(__m256 ev1, __m256 ev2) -> __m256
+{
+    auto const zero = _mm256_setzero_ps();
+
+    return _mm256_add_ps(_mm256_max_ps(ev1, zero), _mm256_max_ps(ev2, zero));
+}
+
+inline auto coherence_8(__m256 ev1, __m256 ev2) -> __m256
+{
+    auto const s = _mm256_add_ps(ev1, ev2);
+    auto const c = _mm256_div_ps(_mm256_sub_ps(ev1, ev2), s);
+
+    auto const zero = _mm256_cmp_ps(s, _mm256_setzero_ps(), _CMP_EQ_OQ);
+
+    return _mm256_blendv_ps(c, _mm256_set1_ps(1.0f), zero);
+}
+
+#endif /* defined(__AVX2__) */
+
+
+/*
+ * Iterate over n tensors with a stride of P scalars, starting at scalar O.
+ * Calls fn_v(i, ev1, ev2) for blocks of 8 tensors starting at i, if
+ * supported, and fn_s(i, ev1, ev2) for single tensors.
+ */
+template<index_t P, index_t O, typename T, typename FV, typename FS>
+void for_each(T const* in, index_t n, FV fn_v, FS fn_s)
+{
+    index_t i = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f32> && (P == 3 || P == 6)) {
+        for (; i + 8 <= n; i += 8) {
+            __m256 xx, xy, yy;
+            __m256 ev1, ev2;
+
+            if constexpr (P == 3) {
+                load_3(in + i * P, xx, xy, yy);
+            } else {
+                load_6<O / 3>(in + i * P, xx, xy, yy);
+            }
+
+            eigenvalues_8(xx, xy, yy, ev1, ev2);
+            fn_v(i, ev1, ev2);
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        auto const* m = in + i * P + O;
+
+        auto const [ev1, ev2] = Mat2s<T> { m[0], m[1], m[2] }.eigenvalues();
+        fn_s(i, ev1, ev2);
+    }
+}
+
+/*
+ * Dispatch on the layout of the tensor image.
+ */
+template<index_t K, typename T, typename FV, typename FS>
+void for_each(Image<Mat2s<T>> const& in, FV fn_v, FS fn_s)
+{
+    static_assert(K == 0);
+    assert(in.stride() == in.size().x);
+
+    for_each<3, 0>(reinterpret_cast<T const*>(in.data()), in.size().span(), fn_v, fn_s);
+}
+
+template<index_t K, typename T, typename FV, typename FS>
+void for_each(Image<std::array<Mat2s<T>, 2>> const& in, FV fn_v, FS fn_s)
+{
+    static_assert(K == 0 || K == 1);
+    assert(in.stride() == in.size().x);
+
+    for_each<6, 3 * K>(reinterpret_cast<T const*>(in.data()), in.size().span(), fn_v, fn_s);
+}
+
+template<index_t K, typename T, typename FV, typename FS>
+void for_each(TensorImage<T> const& in, FV fn_v, FS fn_s)
+{
+    static_assert(K == 0);
+
+    auto const* const pxx = in.xx();
+    auto const* const pxy = in.xy();
+    auto const* const pyy = in.yy();
+
+    auto const n = in.size().span();
+
+    index_t i = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f32>) {
+        for (; i + 8 <= n; i += 8) {
+            __m256 ev1, ev2;
+
+            // planar layout: no transpose required
+            auto const xx = _mm256_loadu_ps(pxx + i);
+            auto const xy = _mm256_loadu_ps(pxy + i);
+            auto const yy = _mm256_loadu_ps(pyy + i);
+
+            eigenvalues_8(xx, xy, yy, ev1, ev2);
+            fn_v(i, ev1, ev2);
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        auto const [ev1, ev2] = Mat2s<T> { pxx[i], pxy[i], pyy[i] }.eigenvalues();
+        fn_s(i, ev1, ev2);
+    }
+}
+
+} /* namespace eigen2::impl */
+
+
+/*
+ * Bulk versions of Mat2s::eigenvalues() and the quantities derived from it.
+ *
+ * The input is either an image of Mat2s, a planar TensorImage, or an image
+ * of two interleaved tensors (see structure_tensor_hessian()), of which
+ * tensor K is used.
+ * For f32 and AVX2, 8 tensors are processed at once without branches.
+ */
+template<index_t K=0, typename I, typename T>
+void eigenvalues(Image<std::array<T, 2>>& out, I const& in)
+{
+    assert(out.size() == in.size());
+
+    auto const fn_v = [&](index_t i, auto ev1, auto ev2) {
+#if defined(__AVX2__)
+        auto* const dst = reinterpret_cast<T*>(out.data());
+
+        auto const lo = _mm256_unpacklo_ps(ev1, ev2);
+        auto const hi = _mm256_unpackhi_ps(ev1, ev2);
+
+        _mm256_storeu_ps(dst + 2 * i,     _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+#endif
+    };
+
+    auto const fn_s = [&](index_t i, T ev1, T ev2) {
+        out[i] = { ev1, ev2 };
+    };
+
+    eigen2::impl::for_each<K>(in, fn_v, fn_s);
+}
+
+/*
+ * Sum of the positive parts of both eigenvalues, max(ev1, 0) + max(ev2, 0).
+ */
+template<index_t K=0, typename I, typename T>
+void eigenvalues_pos_sum(Image<T>& out, I const& in)
+{
+    assert(out.size() == in.size());
+
+    auto* const dst = out.data();
+
+    auto const fn_v = [&](index_t i, auto ev1, auto ev2) {
+#if defined(__AVX2__)
+        _mm256_storeu_ps(dst + i, eigen2::impl::pos_sum_8(ev1, ev2));
+#endif
+    };
+
+    auto const fn_s = [&](index_t i, T ev1, T ev2) {
+        dst[i] = eigen2::impl::pos_sum(ev1, ev2);
+    };
+
+    eigen2::impl::for_each<K>(in, fn_v, fn_s);
+}
+
+/*
+ * As eigenvalues_pos_sum(), and additionally the coherence
+ * (ev1 - ev2) / (ev1 + ev2), which is one if both eigenvalues sum to zero.
+ */
+template<index_t K=0, typename I, typename T>
+void eigenvalues_pos_sum_coherence(Image<T>& psum, Image<T>& coh, I const& in)
+{
+    assert(psum.size() == in.size());
+    assert(coh.size() == in.size());
+
+    auto* const dst_p = psum.data();
+    auto* const dst_c = coh.data();
+
+    auto const fn_v = [&](index_t i, auto ev1, auto ev2) {
+#if defined(__AVX2__)
+        _mm256_storeu_ps(dst_p + i, eigen2::impl::pos_sum_8(ev1, ev2));
+        _mm256_storeu_ps(dst_c + i, eigen2::impl::coherence_8(ev1, ev2));
+#endif
+    };
+
+    auto const fn_s = [&](index_t i, T ev1, T ev2) {
+        dst_p[i] = eigen2::impl::pos_sum(ev1, ev2);
+        dst_c[i] = eigen2::impl::coherence(ev1, ev2);
+    };
+
+    eigen2::impl::for_each<K>(in, fn_v, fn_s);
+}
+
+} /* namespace iptsd::alg */
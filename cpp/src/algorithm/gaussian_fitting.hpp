@@ -3,6 +3,7 @@
 #include "types.hpp"
 #include "container/image.hpp"
 
+#include "math/exp.hpp"
 #include "math/num.hpp"
 
 #include "math/vec2.hpp"
@@ -12,9 +13,21 @@
 #include "math/mat6.hpp"
 #include "math/sle6.hpp"
 
+#include "utils/access.hpp"
+
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <array>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 
 namespace iptsd::alg::gfit {
@@ -28,14 +41,60 @@ struct BBox {
     index_t ymin, ymax;
 };
 
+
+inline auto size(BBox const& b) -> index2_t
+{
+    return { b.xmax - b.xmin + 1, b.ymax - b.ymin + 1 };
+}
+
+
+// maximum size of the sampling window of a contact
+inline constexpr index2_t window_size = { 11, 11 };
+
+/*
+ * Fixed-size buffer for the sampling window of a contact. Stored inline, so
+ * that the parameters of all contacts occupy a single contiguous block.
+ */
+template<class T>
+struct Window {
+public:
+    std::array<T, window_size.x * window_size.y> data;
+
+public:
+    constexpr auto operator[] (index2_t i) -> T&;
+    constexpr auto operator[] (index2_t i) const -> T const&;
+};
+
+template<class T>
+inline constexpr auto Window<T>::operator[] (index2_t i) -> T&
+{
+    auto const ravel = [](index2_t shape, index2_t i) {
+        return i.y * shape.x + i.x;
+    };
+
+    return utils::access::access<T>(data, ravel, window_size, i);
+}
+
+template<class T>
+inline constexpr auto Window<T>::operator[] (index2_t i) const -> T const&
+{
+    auto const ravel = [](index2_t shape, index2_t i) {
+        return i.y * shape.x + i.x;
+    };
+
+    return utils::access::access<T>(data, ravel, window_size, i);
+}
+
+
 template<class T>
 struct Parameters {
     bool     valid;     // flag to invalidate parameters
+    bool     converged; // flag set by fit() once the parameters are stable
     T        scale;     // alpha
     Vec2<T>  mean;      // mu
     Mat2s<T> prec;      // precision matrix, aka. inverse covariance matrix, aka. sigma^-1
     BBox     bounds;    // local bounds for sampling
-    Image<T> weights;   // local weights for sampling
+    Window<T> weights;  // local weights for sampling
 };
 
 
@@ -54,9 +113,146 @@ auto gaussian_like(Vec2<T> x, Vec2<T> mean, Mat2s<T> prec) -> T
 }
 
 
+#if defined(__AVX2__)
+
+inline auto hsum(__m256 v) -> f32
+{
+    auto const lo = _mm256_castps256_ps128(v);
+    auto const hi = _mm256_extractf128_ps(v, 1);
+
+    auto s = _mm_add_ps(lo, hi);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+
+    return _mm_cvtss_f32(s);
+}
+
+inline auto hsum(__m256d v) -> f64
+{
+    auto const lo = _mm256_castpd256_pd128(v);
+    auto const hi = _mm256_extractf128_pd(v, 1);
+
+    auto const s = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+#endif
+
+/*
+ * Center of the sampling window, in pixels.
+ */
+inline auto center(BBox const& b) -> index2_t
+{
+    return { (b.xmin + b.xmax) / 2, (b.ymin + b.ymax) / 2 };
+}
+
+// number of pixels of a window row processed at once in assemble_system()
+inline constexpr index_t row_chunk = 16;
+
+/*
+ * Add the power sums over one chunk of a window row to out, i.e.
+ *
+ *   out[a]     += sum_i d2[i] * x[i]^a    for a = 0..4,
+ *   out[5 + a] += sum_i  v[i] * x[i]^a    for a = 0..2.
+ *
+ * All buffers have row_chunk elements, unused elements must have d2 and v
+ * set to zero.
+ */
+template<class S>
+inline void accumulate_row(std::array<S, 8>& out, S const* x, S const* d2, S const* v)
+{
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<S, f64>) {
+        __m256d acc[8];
+        std::fill(std::begin(acc), std::end(acc), _mm256_setzero_pd());
+
+        for (index_t i = 0; i < row_chunk; i += 4) {
+            auto const xi = _mm256_load_pd(x + i);
+
+            auto d = _mm256_load_pd(d2 + i);
+            for (index_t a = 0; a < 5; ++a) {
+                acc[a] = _mm256_add_pd(acc[a], d);
+                d = _mm256_mul_pd(d, xi);
+            }
+
+            auto w = _mm256_load_pd(v + i);
+            for (index_t a = 0; a < 3; ++a) {
+                acc[5 + a] = _mm256_add_pd(acc[5 + a], w);
+                w = _mm256_mul_pd(w, xi);
+            }
+        }
+
+        for (index_t k = 0; k < 8; ++k) {
+            out[k] += hsum(acc[k]);
+        }
+
+        return;
+    }
+
+    if constexpr (std::is_same_v<S, f32>) {
+        __m256 acc[8];
+        std::fill(std::begin(acc), std::end(acc), _mm256_setzero_ps());
+
+        for (index_t i = 0; i < row_chunk; i += 8) {
+            auto const xi = _mm256_load_ps(x + i);
+
+            auto d = _mm256_load_ps(d2 + i);
+            for (index_t a = 0; a < 5; ++a) {
+                acc[a] = _mm256_add_ps(acc[a], d);
+                d = _mm256_mul_ps(d, xi);
+            }
+
+            auto w = _mm256_load_ps(v + i);
+            for (index_t a = 0; a < 3; ++a) {
+                acc[5 + a] = _mm256_add_ps(acc[5 + a], w);
+                w = _mm256_mul_ps(w, xi);
+            }
+        }
+
+        for (index_t k = 0; k < 8; ++k) {
+            out[k] += hsum(acc[k]);
+        }
+
+        return;
+    }
+#endif
+
+    for (index_t i = 0; i < row_chunk; ++i) {
+        auto d = d2[i];
+        for (index_t a = 0; a < 5; ++a) {
+            out[a] += d;
+            d *= x[i];
+        }
+
+        auto w = v[i];
+        for (index_t a = 0; a < 3; ++a) {
+            out[5 + a] += w;
+            w *= x[i];
+        }
+    }
+}
+
+/*
+ * Assemble the normal equations of the weighted least-squares fit of
+ *
+ *   log(d) = chi^T phi(x, y),  phi = (x^2, 2xy, y^2, x, y, 1),
+ *
+ * with weights d^2. The resulting matrix is symmetric positive
+ * semi-definite. Both matrix and right-hand side only depend on the 21
+ * moments sum d^2 x^a y^b (a + b <= 4) and sum d^2 log(d) x^a y^b
+ * (a + b <= 2). We compute these once, first summing over x per window row
+ * and then combining the row sums with the powers of y, and expand them at
+ * the end.
+ *
+ * Coordinates are relative to the window center (see center()), so that the
+ * moments stay small and well-conditioned in single precision. Summing per
+ * SIMD lane, then per row, and then over rows keeps the accumulation error
+ * close to that of pairwise summation. Note that compensated summation is no
+ * option here, as release builds use -ffast-math.
+ */
 template<class T, class S>
 inline void assemble_system(Mat6<S>& m, Vec6<S>& rhs, BBox const& b, Image<T> const& data,
-                            Image<S> const& w)
+                            Window<S> const& w)
 {
     auto const eps = std::numeric_limits<S>::epsilon();
 
@@ -65,74 +261,72 @@ inline void assemble_system(Mat6<S>& m, Vec6<S>& rhs, BBox const& b, Image<T> co
         static_cast<S>(2) * range<S>.y / static_cast<S>(data.size().y),
     };
 
-    std::fill(m.data.begin(), m.data.end(), math::num<T>::zero);
-    std::fill(rhs.data.begin(), rhs.data.end(), math::num<T>::zero);
+    // exponents (a, b) of x^a y^b and factor for each basis function in phi
+    static constexpr std::array<std::array<index_t, 2>, 6> phi = {{
+        { 2, 0 }, { 1, 1 }, { 0, 2 }, { 1, 0 }, { 0, 1 }, { 0, 0 },
+    }};
+
+    static constexpr std::array<S, 6> phi_f = { 1, 2, 1, 1, 1, 1 };
+
+    auto const c = center(b);
+
+    auto md = std::array<std::array<S, 5>, 5> {};   // sum d^2 x^a y^b, as md[a][b]
+    auto mv = std::array<std::array<S, 3>, 3> {};   // sum d^2 log(d) x^a y^b, as mv[a][b]
+
+    alignas(32) auto xs = std::array<S, row_chunk> {};
+    alignas(32) auto ds = std::array<S, row_chunk> {};
+    alignas(32) auto vs = std::array<S, row_chunk> {};
 
     for (index_t iy = b.ymin; iy <= b.ymax; ++iy) {
-        for (index_t ix = b.xmin; ix <= b.xmax; ++ix) {
-            auto const x = static_cast<S>(ix) * scale.x - range<S>.x;
-            auto const y = static_cast<S>(iy) * scale.y - range<S>.y;
-
-            auto const d = w[{ix - b.xmin, iy - b.ymin}] * static_cast<S>(data[{ix, iy}]);
-            auto const v = std::log(d + eps) * d * d;
-
-            rhs[0] += v * x * x;
-            rhs[1] += v * x * y;
-            rhs[2] += v * y * y;
-            rhs[3] += v * x;
-            rhs[4] += v * y;
-            rhs[5] += v;
-
-            m[{0, 0}] += d * d * x * x * x * x;
-            m[{0, 1}] += d * d * x * x * x * y;
-            m[{0, 2}] += d * d * x * x * y * y;
-            m[{0, 3}] += d * d * x * x * x;
-            m[{0, 4}] += d * d * x * x * y;
-            m[{0, 5}] += d * d * x * x;
-
-            m[{1, 0}] += d * d * x * x * x * y;
-            m[{1, 1}] += d * d * x * x * y * y;
-            m[{1, 2}] += d * d * x * y * y * y;
-            m[{1, 3}] += d * d * x * x * y;
-            m[{1, 4}] += d * d * x * y * y;
-            m[{1, 5}] += d * d * x * y;
-
-            m[{2, 0}] += d * d * x * x * y * y;
-            m[{2, 1}] += d * d * x * y * y * y;
-            m[{2, 2}] += d * d * y * y * y * y;
-            m[{2, 3}] += d * d * x * y * y;
-            m[{2, 4}] += d * d * y * y * y;
-            m[{2, 5}] += d * d * y * y;
-
-            m[{3, 0}] += d * d * x * x * x;
-            m[{3, 1}] += d * d * x * x * y;
-            m[{3, 2}] += d * d * x * y * y;
-            m[{3, 3}] += d * d * x * x;
-            m[{3, 4}] += d * d * x * y;
-            m[{3, 5}] += d * d * x;
-
-            m[{4, 0}] += d * d * x * x * y;
-            m[{4, 1}] += d * d * x * y * y;
-            m[{4, 2}] += d * d * y * y * y;
-            m[{4, 3}] += d * d * x * y;
-            m[{4, 4}] += d * d * y * y;
-            m[{4, 5}] += d * d * y;
-
-            m[{5, 0}] += d * d * x * x;
-            m[{5, 1}] += d * d * x * y;
-            m[{5, 2}] += d * d * y * y;
-            m[{5, 3}] += d * d * x;
-            m[{5, 4}] += d * d * y;
-            m[{5, 5}] += d * d;
+        auto const y = static_cast<S>(iy - c.y) * scale.y;
+
+        // power sums over x for this row
+        auto r = std::array<S, 8> {};
+
+        for (index_t x0 = b.xmin; x0 <= b.xmax; x0 += row_chunk) {
+            for (index_t i = 0; i < row_chunk; ++i) {
+                auto const ix = x0 + i;
+
+                if (ix > b.xmax) {
+                    xs[i] = math::num<S>::zero;
+                    ds[i] = math::num<S>::zero;
+                    vs[i] = math::num<S>::zero;
+                    continue;
+                }
+
+                auto const d = w[{ix - b.xmin, iy - b.ymin}] * static_cast<S>(data[{ix, iy}]);
+
+                xs[i] = static_cast<S>(ix - c.x) * scale.x;
+                ds[i] = d * d;
+                vs[i] = std::log(d + eps) * d * d;
+            }
+
+            accumulate_row(r, xs.data(), ds.data(), vs.data());
+        }
+
+        // combine with powers of y
+        auto yb = math::num<S>::one;
+        for (index_t pb = 0; pb < 5; ++pb) {
+            for (index_t pa = 0; pa + pb < 5; ++pa) {
+                md[pa][pb] += r[pa] * yb;
+            }
+
+            for (index_t pa = 0; pa + pb < 3; ++pa) {
+                mv[pa][pb] += r[5 + pa] * yb;
+            }
+
+            yb *= y;
         }
     }
 
-    m[{0, 1}] *= static_cast<S>(2);
-    m[{1, 1}] *= static_cast<S>(2);
-    m[{2, 1}] *= static_cast<S>(2);
-    m[{3, 1}] *= static_cast<S>(2);
-    m[{4, 1}] *= static_cast<S>(2);
-    m[{5, 1}] *= static_cast<S>(2);
+    // expand moments
+    for (index_t i = 0; i < 6; ++i) {
+        rhs[i] = phi_f[i] * mv[phi[i][0]][phi[i][1]];
+
+        for (index_t j = 0; j < 6; ++j) {
+            m[{i, j}] = phi_f[i] * phi_f[j] * md[phi[i][0] + phi[j][0]][phi[i][1] + phi[j][1]];
+        }
+    }
 }
 
 template<class T>
@@ -156,79 +350,294 @@ bool extract_params(Vec6<T> const& chi, T& scale, Vec2<T>& mean, Mat2s<T>& prec,
 }
 
 
+/*
+ * Check whether the sampling window of params[i] overlaps with the window of
+ * any other valid contact.
+ */
+template<class T>
+auto shares_window(std::vector<Parameters<T>> const& params, std::size_t i) -> bool
+{
+    auto const& a = params[i].bounds;
+
+    for (std::size_t j = 0; j < params.size(); ++j) {
+        auto const& b = params[j].bounds;
+
+        if (j == i || !params[j].valid) {
+            continue;
+        }
+
+        if (a.xmin <= b.xmax && b.xmin <= a.xmax && a.ymin <= b.ymax && b.ymin <= a.ymax) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Compute the weights of each contact, i.e. its Gaussian normalized by the
+ * sum of the Gaussians of all contacts, over its sampling window.
+ *
+ * Where the window of a contact overlaps with no other window, the total is
+ * the scaled Gaussian v itself, so the weight is v / v = 1 where v is
+ * positive and v otherwise (no normalization). We thus only accumulate into
+ * total, and clear and normalize it, over overlapping windows. The
+ * exponentials of a window are evaluated all at once, using the vectorized
+ * exp_approx().
+ */
 template<class T>
 inline void update_weight_maps(std::vector<Parameters<T>>& params, Image<T>& total)
 {
+    // overlap flags on the stack, only fall back to the heap for very many contacts
+    constexpr std::size_t stack_len = 64;
+
     auto const scale = Vec2<T> {
         static_cast<T>(2) * range<T>.x / static_cast<T>(total.size().x),
         static_cast<T>(2) * range<T>.y / static_cast<T>(total.size().y),
     };
 
-    std::fill(total.begin(), total.end(), math::num<T>::zero);
+    bool shared_stack[stack_len];
+    auto shared_heap = std::unique_ptr<bool[]>{};
+
+    bool* shared = shared_stack;
+    if (params.size() > stack_len) {
+        shared_heap = std::make_unique<bool[]>(params.size());
+        shared = shared_heap.get();
+    }
+
+    // find overlapping windows once, the bounds do not change below
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        shared[i] = params[i].valid && shares_window(params, i);
+    }
+
+    // clear total over all overlapping windows
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        auto const& p = params[i];
+
+        if (!shared[i]) {
+            continue;
+        }
+
+        for (index_t y = p.bounds.ymin; y <= p.bounds.ymax; ++y) {
+            T* const row = &total[{p.bounds.xmin, y}];
+            std::fill(row, row + size(p.bounds).x, math::num<T>::zero);
+        }
+    }
+
+    // evaluate Gaussians, directly normalizing the weights of isolated windows
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        auto& p = params[i];
 
-    // compute individual Gaussians in sample windows
-    for (auto& p : params) {
         if (!p.valid) {
             continue;
         }
 
-        for (index_t iy = p.bounds.ymin; iy <= p.bounds.ymax; ++iy) {
-            for (index_t ix = p.bounds.xmin; ix <= p.bounds.xmax; ++ix) {
-                auto const x = static_cast<T>(ix) * scale.x - range<T>.x;
-                auto const y = static_cast<T>(iy) * scale.y - range<T>.y;
+        auto const n = size(p.bounds);
+        auto const s = p.scale;
 
-                auto const v = p.scale * gaussian_like<T>({x, y}, p.mean, p.prec);
+        // exponent of the Gaussian, quadratic in x along each row
+        auto dx = std::array<T, window_size.x> {};
+        for (index_t ix = 0; ix < window_size.x; ++ix) {
+            dx[ix] = static_cast<T>(p.bounds.xmin + ix) * scale.x - range<T>.x - p.mean.x;
+        }
+
+        auto const cx = -p.prec.xx / static_cast<T>(2);
+        auto const cxy = -p.prec.xy;
+        auto const cy = -p.prec.yy / static_cast<T>(2);
+
+        // note: the weights are stored inside of p, so only use local copies
+        // of the parameters in the loops below to avoid aliasing
+        for (index_t iy = 0; iy < n.y; ++iy) {
+            auto const dy = static_cast<T>(p.bounds.ymin + iy) * scale.y - range<T>.y - p.mean.y;
+            auto const by = cxy * dy;
+            auto const ay = cy * dy * dy;
+
+            T* const w = &p.weights[{0, iy}];
 
-                p.weights[{ix - p.bounds.xmin, iy - p.bounds.ymin}] = v;
+            for (index_t ix = 0; ix < window_size.x; ++ix) {
+                w[ix] = (cx * dx[ix] + by) * dx[ix] + ay;
+            }
+        }
+
+        // evaluate all rows at once, so that independent vectors can overlap
+        math::exp_approx(p.weights.data.data(), p.weights.data.data(), n.y * window_size.x);
+
+        for (index_t iy = 0; iy < n.y; ++iy) {
+            T* const w = &p.weights[{0, iy}];
+
+            if (shared[i]) {
+                T* const t = &total[{p.bounds.xmin, p.bounds.ymin + iy}];
+
+                for (index_t ix = 0; ix < n.x; ++ix) {
+                    auto const v = s * w[ix];
+
+                    w[ix] = v;
+                    t[ix] += v;
+                }
+            } else {
+                for (index_t ix = 0; ix < n.x; ++ix) {
+                    auto const v = s * w[ix];
+
+                    w[ix] = v > math::num<T>::zero ? math::num<T>::one : v;
+                }
             }
         }
     }
 
-    // sum up total
-    for (auto& p : params) {
-        if (!p.valid) {
+    // normalize weights of overlapping windows
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        auto& p = params[i];
+
+        if (!shared[i]) {
             continue;
         }
 
-        for (index_t y = p.bounds.ymin; y <= p.bounds.ymax; ++y) {
-            for (index_t x = p.bounds.xmin; x <= p.bounds.xmax; ++x) {
-                total[{x, y}] += p.weights[{x - p.bounds.xmin, y - p.bounds.ymin}];
+        auto const n = size(p.bounds);
+
+        for (index_t iy = 0; iy < n.y; ++iy) {
+            T* const w = &p.weights[{0, iy}];
+            T const* const t = &total[{p.bounds.xmin, p.bounds.ymin + iy}];
+
+            for (index_t ix = 0; ix < n.x; ++ix) {
+                if (t[ix] > math::num<T>::zero) {
+                    w[ix] /= t[ix];
+                }
             }
         }
     }
+}
 
-    // normalize weights
-    for (auto& p : params) {
+/*
+ * Check whether an update of the parameters is small enough to stop, i.e.
+ * the mean moved by at most tol pixels and no entry of the precision matrix
+ * changed by more than tol relative to its largest entry.
+ */
+template<class T>
+auto converged(Parameters<T> const& p, Vec2<T> mean, Mat2s<T> prec, Vec2<T> scale, T tol) -> bool
+{
+    auto const dx = (p.mean.x - mean.x) / scale.x;
+    auto const dy = (p.mean.y - mean.y) / scale.y;
+
+    if (dx * dx + dy * dy > tol * tol) {
+        return false;
+    }
+
+    auto const norm = std::max({ std::abs(p.prec.xx), std::abs(p.prec.xy), std::abs(p.prec.yy) });
+    auto const diff = std::max({
+        std::abs(p.prec.xx - prec.xx),
+        std::abs(p.prec.xy - prec.xy),
+        std::abs(p.prec.yy - prec.yy),
+    });
+
+    return diff <= tol * norm;
+}
+
+/*
+ * Executor running all tasks of a loop on the calling thread, see
+ * utils::ThreadPool for the interface.
+ */
+struct Serial {
+    auto size() const -> std::size_t
+    {
+        return 1;
+    }
+
+    template<class F>
+    void run(std::size_t n, F&& fn) const
+    {
+        for (std::size_t i = 0; i < n; ++i) {
+            fn(i);
+        }
+    }
+};
+
+/*
+ * Perform one update of the parameters in params[begin..end) that are valid
+ * and not converged yet. At most one batch (see math::ldlt_batch_size) of
+ * parameters may be updated at once. Only touches the given parameters, so
+ * that disjoint ranges may be updated in parallel.
+ */
+template<class T, class S>
+void update_params(std::vector<Parameters<S>>& params, std::size_t begin, std::size_t end,
+                   Image<T> const& data, S tol, S eps)
+{
+    constexpr auto n_batch = math::ldlt_batch_size<S>;
+
+    auto const scale = Vec2<S> {
+        static_cast<S>(2) * range<S>.x / static_cast<S>(data.size().x),
+        static_cast<S>(2) * range<S>.y / static_cast<S>(data.size().y),
+    };
+
+    auto sys = std::array<Mat6<S>, n_batch> {};
+    auto rhs = std::array<Vec6<S>, n_batch> {};
+    auto chi = std::array<Vec6<S>, n_batch> {};
+    auto ok = std::array<bool, n_batch> {};
+    auto batch = std::array<std::size_t, n_batch> {};
+
+    // assemble systems of linear equations
+    std::size_t n = 0;
+
+    for (std::size_t i = begin; i < end; ++i) {
+        if (!params[i].valid || params[i].converged) {
+            continue;
+        }
+
+        assemble_system(sys[n], rhs[n], params[i].bounds, data, params[i].weights);
+        batch[n++] = i;
+    }
+
+    // solve them all at once
+    math::ldlt_solve_batch(sys, rhs, chi, ok, n, eps);
+
+    for (std::size_t k = 0; k < n; ++k) {
+        auto& p = params[batch[k]];
+
+        auto const mean = p.mean;
+        auto const prec = p.prec;
+
+        p.valid = ok[k];
         if (!p.valid) {
+            spdlog::warn("invalid equation system");
             continue;
         }
 
-        for (index_t y = p.bounds.ymin; y <= p.bounds.ymax; ++y) {
-            for (index_t x = p.bounds.xmin; x <= p.bounds.xmax; ++x) {
-                if (total[{x, y}] > static_cast<T>(0)) {
-                    p.weights[{x - p.bounds.xmin, y - p.bounds.ymin}] /= total[{x, y}];
-                }
-            }
+        // get parameters
+        p.valid = extract_params(chi[k], p.scale, p.mean, p.prec, eps);
+        if (!p.valid) {
+            spdlog::warn("parameter extraction failed");
+            continue;
         }
+
+        // system is relative to the window center
+        auto const c = center(p.bounds);
+
+        p.mean.x += static_cast<S>(c.x) * scale.x - range<S>.x;
+        p.mean.y += static_cast<S>(c.y) * scale.y - range<S>.y;
+
+        p.converged = tol > math::num<S>::zero && converged(p, mean, prec, scale, tol);
     }
 }
 
 } /* namespace impl */
 
 
-// TODO: vector as parameter container is not good... drops image memory when resized
-
+/*
+ * Provide parameters for at least n contacts and invalidate all of them.
+ * Parameters hold no heap memory, reserving the expected maximum number of
+ * contacts up front avoids any allocation during fitting.
+ */
 template<class T>
-void reserve(std::vector<Parameters<T>>& params, std::size_t n, index2_t size)
+void reserve(std::vector<Parameters<T>>& params, std::size_t n)
 {
     if (n > params.size()) {
         params.resize(n, Parameters<T> {
+            false,
             false,
             static_cast<T>(1),
             { static_cast<T>(0), static_cast<T>(0) },
             { static_cast<T>(1), static_cast<T>(0), static_cast<T>(1) },
             { 0, -1, 0, -1 },
-            Image<T> { size },
+            {},
         });
     }
 
@@ -237,9 +646,21 @@ void reserve(std::vector<Parameters<T>>& params, std::size_t n, index2_t size)
     }
 }
 
-template<class T, class S>
-void fit(std::vector<Parameters<S>>& params, Image<T> const& data,
-         Image<S>& tmp, unsigned int n_iter, S eps=math::num<S>::eps)
+/*
+ * Fit the given parameters to the data, using at most n_iter iterations.
+ * Parameters whose update falls below the tolerance tol (see converged()) are
+ * marked as converged and not updated anymore, a tolerance of zero always
+ * runs all iterations. Returns the total number of updates across all
+ * parameters.
+ *
+ * The parameters are updated independently of each other, in chunks of at
+ * most one batch, which are distributed over the threads of exec (see
+ * utils::ThreadPool). The weight update between iterations is the only point
+ * at which all threads need to synchronize.
+ */
+template<class T, class S, class E>
+auto fit(std::vector<Parameters<S>>& params, Image<T> const& data, Image<S>& tmp,
+         unsigned int n_iter, S tol, S eps, E& exec) -> unsigned int
 {
     auto const scale = Vec2<S> {
         static_cast<S>(2) * range<S>.x / static_cast<S>(data.size().x),
@@ -260,39 +681,42 @@ void fit(std::vector<Parameters<S>>& params, Image<T> const& data,
         p.prec.xx = p.prec.xx / (scale.x * scale.x);
         p.prec.xy = p.prec.xy / (scale.x * scale.y);
         p.prec.yy = p.prec.yy / (scale.y * scale.y);
+
+        p.converged = false;
     }
 
+    unsigned int n_updates = 0;
+
     // perform iterations
-    for (unsigned int i = 0; i < n_iter; ++i) {
-        // update weights
-        impl::update_weight_maps(params, tmp);
+    for (unsigned int iter = 0; iter < n_iter; ++iter) {
+        // range of parameters to update
+        std::size_t n_active = 0;
+        std::size_t end = 0;
+
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            if (params[i].valid && !params[i].converged) {
+                n_active += 1;
+                end = i + 1;
+            }
+        }
 
-        // fit individual parameters
-        for (auto& p : params) {
-            auto sys = Mat6<S>{};
-            auto rhs = Vec6<S>{};
-            auto chi = Vec6<S>{};
+        if (n_active == 0) {
+            break;
+        }
 
-            if (!p.valid) {
-                continue;
-            }
+        // update weights
+        impl::update_weight_maps(params, tmp);
 
-            // assemble system of linear equations
-            impl::assemble_system(sys, rhs, p.bounds, data, p.weights);
+        // split it evenly across threads, in chunks of at most one batch
+        auto const n_threads = exec.size();
+        auto const chunk = std::clamp<std::size_t>((end + n_threads - 1) / n_threads, 1,
+                                                   math::ldlt_batch_size<S>);
 
-            // solve systems
-            p.valid = math::ge_solve(sys, rhs, chi, eps);
-            if (!p.valid) {
-                spdlog::warn("invalid equation system");
-                continue;
-            }
+        exec.run((end + chunk - 1) / chunk, [&](std::size_t k) {
+            impl::update_params(params, k * chunk, std::min(end, (k + 1) * chunk), data, tol, eps);
+        });
 
-            // get parameters
-            p.valid = impl::extract_params(chi, p.scale, p.mean, p.prec, eps);
-            if (!p.valid) {
-                spdlog::warn("parameter extraction failed");
-            }
-        }
+        n_updates += n_active;
     }
 
     // undo down-scaling
@@ -310,6 +734,16 @@ void fit(std::vector<Parameters<S>>& params, Image<T> const& data,
         p.prec.xy = p.prec.xy * scale.x * scale.y;
         p.prec.yy = p.prec.yy * scale.y * scale.y;
     }
+
+    return n_updates;
+}
+
+template<class T, class S>
+auto fit(std::vector<Parameters<S>>& params, Image<T> const& data, Image<S>& tmp,
+         unsigned int n_iter, S tol=math::num<S>::zero, S eps=math::num<S>::eps) -> unsigned int
+{
+    auto exec = impl::Serial {};
+    return fit(params, data, tmp, n_iter, tol, eps, exec);
 }
 
 } /* namespace iptsd::alg::gfit */
@@ -18,18 +18,23 @@
 #include "types.hpp"
 #include "container/image.hpp"
 
+#include <cassert>
+#include <limits>
 #include <numeric>
+#include <utility>
 
 
 namespace iptsd::alg {
 namespace impl {
 
-inline auto is_root(Image<u16> const& forest, u16 idx) -> bool
+template<typename F>
+inline auto is_root(F const& forest, u16 idx) -> bool
 {
     return idx == forest[idx];
 }
 
-inline auto find_root(Image<u16> const& forest, u16 idx) -> u16
+template<typename F>
+inline auto find_root(F const& forest, u16 idx) -> u16
 {
     while (!is_root(forest, idx)) {
         idx = forest[idx];
@@ -38,7 +43,8 @@ inline auto find_root(Image<u16> const& forest, u16 idx) -> u16
     return idx;
 }
 
-inline void set_root(Image<u16>& forest, u16 idx, u16 new_root)
+template<typename F>
+inline void set_root(F& forest, u16 idx, u16 new_root)
 {
     while (!is_root(forest, idx)) {
         idx = std::exchange(forest[idx], new_root);
@@ -47,7 +53,8 @@ inline void set_root(Image<u16>& forest, u16 idx, u16 new_root)
     forest[idx] = new_root;
 }
 
-inline auto merge(Image<u16>& forest, u16 t1_index, u16 t1_root, u16 t2_index, u16 bg)
+template<typename F>
+inline auto merge(F& forest, u16 t1_index, u16 t1_root, u16 t2_index, u16 bg)
         -> std::pair<u16, u16>
 {
     if (forest[t2_index] == bg) {
@@ -97,6 +104,48 @@ inline auto find_background(Image<T> const& data, T threshold) -> u16
     return std::numeric_limits<u16>::max();
 }
 
+/*
+ * Pass 2 for padded forests: Forest indices are relative to the start of
+ * the allocation, background nodes are zero.
+ *
+ * Roots are the smallest index of their tree, so the label of a component
+ * is assigned at its first pixel in row-major order, before any other pixel
+ * of the component is visited. new_label(l) is called right after label l
+ * has been assigned, add_pixel(l, p) for each pixel p with label l > 0.
+ */
+template<typename FL, typename FP>
+inline auto resolve_padded(Image<u16>& out, Image<u16>& forest, FL new_label, FP add_pixel) -> u16
+{
+    u16* const f = forest.data() - forest.offset();
+
+    u16 n_labels = 0;
+    for (index_t y = 0; y < forest.size().y; ++y) {
+        auto const row = static_cast<u16>(forest.offset() + y * forest.stride());
+
+        for (index_t x = 0; x < forest.size().x; ++x) {
+            auto const i = static_cast<u16>(row + x);
+
+            if (f[i] == 0) {
+                // background
+                out[{ x, y }] = 0;
+                continue;
+            }
+
+            if (!is_root(f, i)) {
+                f[i] = f[f[i]];
+            } else {
+                f[i] = ++n_labels;
+                new_label(n_labels);
+            }
+
+            out[{ x, y }] = f[i];
+            add_pixel(f[i], index2_t { x, y });
+        }
+    }
+
+    return n_labels;
+}
+
 } /* namespace impl */
 
 template<int C=4, typename T>
@@ -205,4 +254,83 @@ auto label(Image<u16>& out, Image<T> const& data, T threshold) -> u16
     return impl::resolve(out, background);
 }
 
+/*
+ * Same as above, using a forest with halo (see Layout) as scratch memory.
+ *
+ * The halo is set to background, so that each pixel can be merged with all
+ * of its neighbors without special-casing the border. Node 0, the first halo
+ * element, serves as background node. The forest must have the same size as
+ * the data, a halo of at least one pixel, and must be indexable via u16.
+ */
+template<int C=4, typename T>
+auto label(Image<u16>& out, Image<T> const& data, T threshold, Image<u16>& forest) -> u16
+{
+    return label<C>(out, data, threshold, forest, [](u16) {}, [](u16, index2_t) {});
+}
+
+/*
+ * Same as above, additionally accumulating per-component statistics while
+ * labels are assigned, without a separate pass over the labels: new_label(l)
+ * is called once per label l = 1..n, in increasing order and before any
+ * pixel of that label, and add_pixel(l, p) once for each pixel p of label l,
+ * in row-major order.
+ */
+template<int C=4, typename T, typename FL, typename FP>
+auto label(Image<u16>& out, Image<T> const& data, T threshold, Image<u16>& forest,
+           FL new_label, FP add_pixel) -> u16
+{
+    static_assert(C == 4 || C == 8);
+
+    assert(forest.size() == data.size());
+    assert(forest.halo() >= 1);
+    assert((data.size().y + 2 * forest.halo()) * forest.stride() <= std::numeric_limits<u16>::max());
+
+    u16 constexpr background = 0;
+
+    forest.fill_halo(background);
+
+    u16* const f = forest.data() - forest.offset();
+
+    // strides
+    index_t const s_left = 1;
+    index_t const s_up = forest.stride();
+    index_t const s_up_left = s_up + 1;
+    index_t const s_up_right = s_up - 1;
+
+    // pass 1: build forest
+    for (index_t y = 0; y < data.size().y; ++y) {
+        auto const row = static_cast<u16>(forest.offset() + y * forest.stride());
+
+        for (index_t x = 0; x < data.size().x; ++x) {
+            auto const i = static_cast<u16>(row + x);
+
+            // background
+            if (data[{ x, y }] <= threshold) {
+                f[i] = background;
+                continue;
+            }
+
+            // start by assuming we are a new root, creating a new tree...
+            f[i] = i;
+
+            // ... then merge our newly created tree with all neighboring trees
+            auto tr = std::pair<u16, u16> { i, i };
+            tr = impl::merge(f, tr.first, tr.second, i - s_left, background);
+
+            if constexpr (C == 8) {
+                tr = impl::merge(f, tr.first, tr.second, i - s_up_left, background);
+            }
+
+            tr = impl::merge(f, tr.first, tr.second, i - s_up, background);
+
+            if constexpr (C == 8) {
+                tr = impl::merge(f, tr.first, tr.second, i - s_up_right, background);
+            }
+        }
+    }
+
+    // pass 2: assign labels
+    return impl::resolve_padded(out, forest, new_label, add_pixel);
+}
+
 } /* namespace iptsd::alg */
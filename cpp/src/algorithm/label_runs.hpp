@@ -0,0 +1,262 @@
+#pragma once
+
+/*
+ * Run-based connected component labeling.
+ *
+ * Instead of one union-find node per pixel, each row is split into runs of
+ * consecutive foreground pixels, and runs of adjacent rows are merged if
+ * they touch. The number of nodes thus scales with the number of runs, not
+ * the number of pixels, and is indexed via u32, so that there is no limit on
+ * the image size. Runs are extracted from a bitmask per row, obtained via a
+ * SIMD threshold compare.
+ *
+ * References:
+ *  - Lifeng He, Yuyan Chao and Kenji Suzuki, "A Run-Based Two-Scan Labeling
+ *    Algorithm", IEEE Transactions on Image Processing 17 (2008),
+ *    pp. 749-756.
+ */
+
+#include "types.hpp"
+#include "container/image.hpp"
+
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg::runs {
+
+/*
+ * Run of foreground pixels [x0, x1) in a single row.
+ */
+struct Run {
+    u32 x0, x1;
+    u32 parent;
+    u32 label;
+};
+
+/*
+ * Scratch memory, to be reused across calls to avoid allocations.
+ */
+struct Storage {
+    std::vector<Run> runs;      // all runs, in row-major order
+    std::vector<u32> rows;      // index of the first run per row, plus end
+    std::vector<u64> mask;      // foreground bitmask of the current row
+};
+
+
+namespace impl {
+
+inline auto find_root(std::vector<Run>& runs, u32 i) -> u32
+{
+    // path halving
+    while (runs[i].parent != i) {
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
+    }
+
+    return i;
+}
+
+/*
+ * Union of two trees, keeping the smaller run index as root. Thus, the root
+ * of each component is its first run in row-major order.
+ */
+inline void merge(std::vector<Run>& runs, u32 a, u32 b)
+{
+    a = find_root(runs, a);
+    b = find_root(runs, b);
+
+    if (a < b) {
+        runs[b].parent = a;
+    } else if (b < a) {
+        runs[a].parent = b;
+    }
+}
+
+/*
+ * Set bit x of mask for each row[x] > threshold, x in [0, n).
+ */
+template<typename T>
+inline void threshold_mask(u64* mask, T const* row, index_t n, T threshold)
+{
+    auto const n_words = (n + 63) / 64;
+    for (index_t k = 0; k < n_words; ++k) {
+        mask[k] = 0;
+    }
+
+    index_t x = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f32>) {
+        auto const th = _mm256_set1_ps(threshold);
+
+        for (; x + 8 <= n; x += 8) {
+            auto const v = _mm256_cmp_ps(_mm256_loadu_ps(row + x), th, _CMP_GT_OQ);
+            auto const m = static_cast<u64>(static_cast<unsigned>(_mm256_movemask_ps(v)));
+
+            mask[x / 64] |= m << (x % 64);
+        }
+    }
+#endif
+
+    for (; x < n; ++x) {
+        mask[x / 64] |= static_cast<u64>(row[x] > threshold) << (x % 64);
+    }
+}
+
+/*
+ * Append the runs of set bits in mask[0..n_words) to runs. Runs spanning
+ * multiple words are joined.
+ */
+inline void extract_runs(std::vector<Run>& runs, u64 const* mask, index_t n_words)
+{
+    auto const first = runs.size();
+
+    for (index_t k = 0; k < n_words; ++k) {
+        auto w = mask[k];
+        auto const base = static_cast<u32>(k * 64);
+
+        while (w != 0) {
+            auto const x0 = static_cast<u32>(__builtin_ctzll(w));
+
+            // end of the run: first unset bit above x0
+            auto const inv = ~w & (~u64 { 0 } << x0);
+            auto const x1 = inv != 0 ? static_cast<u32>(__builtin_ctzll(inv)) : 64u;
+
+            if (x0 == 0 && runs.size() > first && runs.back().x1 == base) {
+                runs.back().x1 = base + x1;
+            } else {
+                auto const i = static_cast<u32>(runs.size());
+                runs.push_back(Run { base + x0, base + x1, i, 0 });
+            }
+
+            w = x1 < 64 ? w & (~u64 { 0 } << x1) : 0;
+        }
+    }
+}
+
+/*
+ * Merge the runs [c, c_end) of a row with the touching runs [p, p_end) of
+ * the row above. Runs of both rows are sorted and disjoint, so this is a
+ * single sweep.
+ */
+template<int C>
+inline void merge_rows(std::vector<Run>& runs, u32 p, u32 p_end, u32 c, u32 c_end)
+{
+    // with 8-connectivity, runs also touch diagonally
+    u32 constexpr d = C == 8 ? 1 : 0;
+
+    for (; c < c_end; ++c) {
+        // skip runs ending before the current one starts...
+        while (p < p_end && runs[p].x1 + d <= runs[c].x0) {
+            ++p;
+        }
+
+        // ... then merge all runs starting before it ends, without advancing
+        // p, as the last one may also touch the next run of the current row
+        for (auto q = p; q < p_end && runs[q].x0 < runs[c].x1 + d; ++q) {
+            merge(runs, c, q);
+        }
+    }
+}
+
+} /* namespace impl */
+
+
+/*
+ * Label the connected components of pixels above the threshold, with the
+ * same labels as alg::label(), i.e. numbered by their first pixel in
+ * row-major order, and zero for the background.
+ *
+ * new_label(l) is called once per label l = 1..n, in increasing order and
+ * before any pixel of that label, and add_pixel(l, p) once for each pixel p
+ * of label l, in row-major order. Returns the number of labels. Throws
+ * std::overflow_error if there are more labels than L can represent.
+ */
+template<int C=4, typename L, typename T, typename FL, typename FP>
+auto label(Image<L>& out, Image<T> const& data, T threshold, Storage& storage,
+           FL new_label, FP add_pixel) -> L
+{
+    static_assert(C == 4 || C == 8);
+    static_assert(std::is_unsigned_v<L>);
+
+    assert(out.size() == data.size());
+
+    auto const size = data.size();
+    auto const n_words = (size.x + 63) / 64;
+
+    auto& runs = storage.runs;
+    auto& rows = storage.rows;
+    auto& mask = storage.mask;
+
+    runs.clear();
+    rows.resize(size.y + 1);
+    mask.resize(n_words);
+
+    // pass 1: extract runs and merge them with the row above
+    for (index_t y = 0; y < size.y; ++y) {
+        rows[y] = static_cast<u32>(runs.size());
+
+        impl::threshold_mask(mask.data(), data.data() + y * data.stride(), size.x, threshold);
+        impl::extract_runs(runs, mask.data(), n_words);
+
+        if (y > 0) {
+            impl::merge_rows<C>(runs, rows[y - 1], rows[y], rows[y], static_cast<u32>(runs.size()));
+        }
+    }
+    rows[size.y] = static_cast<u32>(runs.size());
+
+    // pass 2: assign labels, roots always precede the other runs of their tree
+    u32 n_labels = 0;
+    for (index_t y = 0; y < size.y; ++y) {
+        L* const o = out.data() + y * out.stride();
+
+        u32 x = 0;
+        for (auto i = rows[y]; i < rows[y + 1]; ++i) {
+            auto& run = runs[i];
+
+            if (run.parent == i) {
+                if (static_cast<u64>(n_labels) >= static_cast<u64>(std::numeric_limits<L>::max())) {
+                    throw std::overflow_error { "too many labels for the label type" };
+                }
+
+                run.label = ++n_labels;
+                new_label(static_cast<L>(n_labels));
+            } else {
+                run.label = runs[impl::find_root(runs, i)].label;
+            }
+
+            auto const l = static_cast<L>(run.label);
+
+            for (; x < run.x0; ++x) {
+                o[x] = 0;
+            }
+
+            for (; x < run.x1; ++x) {
+                o[x] = l;
+                add_pixel(l, index2_t { static_cast<index_t>(x), y });
+            }
+        }
+
+        for (; x < static_cast<u32>(size.x); ++x) {
+            o[x] = 0;
+        }
+    }
+
+    return static_cast<L>(n_labels);
+}
+
+template<int C=4, typename L, typename T>
+auto label(Image<L>& out, Image<T> const& data, T threshold, Storage& storage) -> L
+{
+    return label<C>(out, data, threshold, storage, [](L) {}, [](L, index2_t) {});
+}
+
+} /* namespace iptsd::alg::runs */
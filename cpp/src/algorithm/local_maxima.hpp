@@ -3,14 +3,211 @@
 #include "types.hpp"
 #include "container/image.hpp"
 
+#include "math/vec2.hpp"
+#include "utils/simd.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 
 namespace iptsd::alg {
+namespace lmax::impl {
+
+/*
+ * Test whether the pixel at p is a local maximum, see below for the kernel.
+ * All neighbors of p must be accessible.
+ */
+template<int C, typename T>
+inline auto is_max(T const* p, index_t s) -> bool
+{
+    T const v = *p;
+
+    bool max = true;
+
+    max &= p[-1] <  v;
+    max &= p[ 1] <= v;
+    max &= p[-s] <  v;
+    max &= p[ s] <= v;
+
+    if constexpr (C == 8) {
+        max &= p[-s - 1] <  v;
+        max &= p[-s + 1] <  v;
+        max &= p[ s - 1] <= v;
+        max &= p[ s + 1] <= v;
+    }
+
+    return max;
+}
+
+#if defined(__AVX2__)
+
+/*
+ * Bitmask of the local maximas in r[0..8), same as is_max() for each pixel.
+ */
+template<int C>
+inline auto max_mask(f32 const* r, index_t s, __m256 threshold) -> u64
+{
+    auto const v = _mm256_loadu_ps(r);
+
+    auto m = _mm256_cmp_ps(v, threshold, _CMP_GT_OQ);
+
+    m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r - 1), v, _CMP_LT_OQ));
+    m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r + 1), v, _CMP_LE_OQ));
+    m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r - s), v, _CMP_LT_OQ));
+    m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r + s), v, _CMP_LE_OQ));
+
+    if constexpr (C == 8) {
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r - s - 1), v, _CMP_LT_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r - s + 1), v, _CMP_LT_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r + s - 1), v, _CMP_LE_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(r + s + 1), v, _CMP_LE_OQ));
+    }
+
+    return static_cast<u64>(static_cast<unsigned>(_mm256_movemask_ps(m)));
+}
+
+/*
+ * Bitmask of the local maximas in r[0..32), two vectors of 16 pixels each.
+ */
+template<int C>
+inline auto max_mask(i16 const* r, index_t s, __m256i threshold) -> u64
+{
+    auto const load = [](i16 const* p) {
+        return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+    };
+
+    auto const half = [&](i16 const* p) {
+        auto const v = load(p);
+
+        // n < v, and n <= v as not n > v
+        auto const lt = [&](index_t o) { return _mm256_cmpgt_epi16(v, load(p + o)); };
+        auto const gt = [&](index_t o) { return _mm256_cmpgt_epi16(load(p + o), v); };
+
+        auto m = _mm256_cmpgt_epi16(v, threshold);
+
+        m = _mm256_and_si256(m, lt(-1));
+        m = _mm256_andnot_si256(gt(1), m);
+        m = _mm256_and_si256(m, lt(-s));
+        m = _mm256_andnot_si256(gt(s), m);
+
+        if constexpr (C == 8) {
+            m = _mm256_and_si256(m, lt(-s - 1));
+            m = _mm256_and_si256(m, lt(-s + 1));
+            m = _mm256_andnot_si256(gt(s - 1), m);
+            m = _mm256_andnot_si256(gt(s + 1), m);
+        }
+
+        return m;
+    };
+
+    return static_cast<u64>(utils::simd::movemask_epi16(half(r), half(r + 16)));
+}
+
+inline auto broadcast(f32 v) -> __m256
+{
+    return _mm256_set1_ps(v);
+}
+
+inline auto broadcast(i16 v) -> __m256i
+{
+    return _mm256_set1_epi16(v);
+}
+
+#endif
+
+/*
+ * Test the pixels d[begin..end) of a row for local maximas, in blocks of 64
+ * pixels, eight (f32) or 32 (i16) at a time via SIMD compares. This gives a
+ * bitmask per block, from which the maximas are extracted with tzcnt. As
+ * maximas are sparse, most blocks yield an empty mask. Outputs the index of
+ * each maximum plus out_offset. All neighbors of the pixels must be
+ * accessible.
+ *
+ * Only full vectors are processed, returns the index of the first pixel that
+ * has not been tested, which is always begin for other types.
+ */
+template<int C, typename T, typename O>
+inline auto find_local_maximas_row(T const* d, index_t begin, index_t end, index_t s,
+                                   index_t out_offset, T threshold, O& output_iter) -> index_t
+{
+    index_t i = begin;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f32> || std::is_same_v<T, i16>) {
+        constexpr index_t w = std::is_same_v<T, f32> ? 8 : 32;
+
+        auto const th = broadcast(threshold);
+
+        // pixels covered by full vectors
+        auto const n_end = begin + (end - begin) / w * w;
+
+        for (; i < n_end; i += 64) {
+            u64 mask = 0;
+
+            for (index_t k = 0; k < 64 && i + k < n_end; k += w) {
+                mask |= max_mask<C>(d + i + k, s, th) << k;
+            }
+
+            while (mask != 0) {
+                *output_iter++ = out_offset + i + __builtin_ctzll(mask);
+                mask &= mask - 1;
+            }
+        }
+
+        i = n_end;
+    }
+#endif
+
+    return i;
+}
+
+/*
+ * Version for images with halo (see Layout), using the same kernel as below.
+ * The halo must be filled with values that are not greater than any pixel,
+ * e.g. std::numeric_limits<T>::lowest(), so that border pixels can be handled
+ * like interior ones. Outputs dense pixel indices, i.e. y * size.x + x.
+ */
+template<int C, typename T, typename O>
+void find_local_maximas_halo(Image<T> const& data, T threshold, O output_iter)
+{
+    assert(data.halo() >= 1);
+
+    auto const size = data.size();
+    auto const s = data.stride();
+
+    for (index_t y = 0; y < size.y; ++y) {
+        T const* const r = data.data() + y * s;
+
+        auto x = find_local_maximas_row<C>(r, 0, size.x, s, y * size.x, threshold, output_iter);
+
+        for (; x < size.x; ++x) {
+            if (r[x] > threshold && is_max<C>(r + x, s)) {
+                *output_iter++ = y * size.x + x;
+            }
+        }
+    }
+}
+
+} /* namespace lmax::impl */
+
 
 template<int C=8, typename T, typename O>
 void find_local_maximas(Image<T> const& data, T threshold, O output_iter)
 {
     static_assert(C == 4 || C == 8);
 
+    if (data.halo() >= 1) {
+        lmax::impl::find_local_maximas_halo<C>(data, threshold, output_iter);
+        return;
+    }
+
+    assert(data.stride() == data.size().x);
+
     index_t i = 0;
 
     /*
@@ -120,6 +317,9 @@ void find_local_maximas(Image<T> const& data, T threshold, O output_iter)
 
         // 0 < x < n - 1
         auto const limit = i + data.size().x - 2;
+
+        i = lmax::impl::find_local_maximas_row<C>(data.data(), i, limit, stride, 0, threshold, output_iter);
+
         for (; i < limit; ++i) {
             if (data[i] <= threshold)
                 continue;
@@ -236,4 +436,39 @@ void find_local_maximas(Image<T> const& data, T threshold, O output_iter)
     }
 }
 
+/*
+ * Sub-pixel position of the local maximum at pixel p, refined by fitting a
+ * parabola through p and its two direct neighbors, separately along each
+ * axis. The offset is limited to half a pixel, and zero along axes on which
+ * p lies on the border or the values are not strictly concave.
+ */
+template<typename T>
+auto refine_local_maxima(Image<T> const& data, index2_t p) -> Vec2<T>
+{
+    auto const offset = [](T l, T c, T r) -> T {
+        auto const d2 = l - static_cast<T>(2) * c + r;
+
+        if (!(d2 < static_cast<T>(0)))
+            return static_cast<T>(0);
+
+        auto const d = (l - r) / (static_cast<T>(2) * d2);
+        return std::clamp(d, static_cast<T>(-0.5), static_cast<T>(0.5));
+    };
+
+    auto const size = data.size();
+    auto const c = data[p];
+
+    auto out = Vec2<T> { static_cast<T>(p.x), static_cast<T>(p.y) };
+
+    if (p.x > 0 && p.x < size.x - 1) {
+        out.x += offset(data[{ p.x - 1, p.y }], c, data[{ p.x + 1, p.y }]);
+    }
+
+    if (p.y > 0 && p.y < size.y - 1) {
+        out.y += offset(data[{ p.x, p.y - 1 }], c, data[{ p.x, p.y + 1 }]);
+    }
+
+    return out;
+}
+
 } /* namespace iptsd::alg */
@@ -1,5 +1,9 @@
 /*
- * Optimized version of convolution.hpp. Do not include directly.
+ * 3x3 convolution with extend border. Do not include directly.
+ *
+ * Reads the previous, current and next row through a border::RowWindow of
+ * radius one, in which rows and columns outside of the image repeat the
+ * nearest edge pixel.
  */
 
 #include "algorithm/convolution.hpp"
@@ -10,8 +14,9 @@ namespace iptsd::alg::conv::impl {
 template<typename T, typename S>
 void conv_3x3_extend(Image<T>& out, Image<T> const& data, Kernel<S, 3, 3> const& kern)
 {
+    assert(out.size() == data.size());
+
     // strides
-    auto const stride_d = data.stride();
     auto const stride_k = kern.stride();
 
     // access helpers
@@ -19,193 +24,25 @@ void conv_3x3_extend(Image<T>& out, Image<T> const& data, Kernel<S, 3, 3> const&
         return kern[4 + dy * stride_k + dx];
     };
 
-    auto const d = [&](index_t i, index_t dx, index_t dy) constexpr -> T {
-        return data[i + dy * stride_d + dx];
-    };
+    auto rows = border::RowWindow<border::Extend, 1, T> { data };
 
     // processing...
-    index_t i = 0;
-
-    // y = 0
-    {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -1) * k(-1,  0);      // extended
-            v += d(i,  0, -1) * k( 0,  0);      // extended
-            v += d(i,  1, -1) * k( 1,  0);      // extended
-
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-
-            v += d(i,  0,  1) * k(-1,  1);      // extended
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-
-            out[i++] = v;
-        }
-
-        // 0 < x < n
-        auto const limit = i + data.size().x - 2;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -1) * k(-1,  0);      // extended
-            v += d(i,  0, -1) * k( 0,  0);      // extended
-            v += d(i,  1, -1) * k( 1,  0);      // extended
+    for (index_t y = 0; y < data.size().y; ++y) {
+        rows.load(y);
 
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
+        T const* const r[3] = { rows.row(-1), rows.row(0), rows.row(1) };
+        T* const dst = out.row(y);
 
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
+        for (index_t x = 0; x < data.size().x; ++x) {
             T v = math::num<T>::zero;
 
-            v += d(i, -1, -1) * k(-1,  0);      // extended
-            v += d(i,  0, -1) * k( 0,  0);      // extended
-            v += d(i,  0, -1) * k( 1,  0);      // extended
-
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  0,  1) * k( 1,  1);      // extended
-
-            out[i++] = v;
-        }
-    }
-
-    // 0 < y < n
-    while (i < data.size().x * (data.size().y - 1)) {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -1) * k(-1, -1);      // extended
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-
-            v += d(i,  0,  1) * k(-1,  1);      // extended
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-
-            out[i++] = v;
-        }
-
-        // 0 < x < n
-        auto const limit = i + data.size().x - 2;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  0, -1) * k( 1, -1);      // extended
-
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  0,  1) * k( 1,  1);      // extended
-
-            out[i++] = v;
-        }
-    }
-
-    // y = n - 1
-    {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -1) * k(-1, -1);      // extended
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-
-            v += d(i,  0,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  1,  0) * k( 1,  1);      // extended
-
-            out[i++] = v;
-        }
-
-        // 1 < x < n - 2
-        auto const limit = i + data.size().x - 2;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-
-            v += d(i, -1,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  1,  0) * k( 1,  1);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  0, -1) * k( 1, -1);      // extended
-
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-
-            v += d(i, -1,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  0,  0) * k( 1,  1);      // extended
+            for (index_t dy = -1; dy <= 1; ++dy) {
+                for (index_t dx = -1; dx <= 1; ++dx) {
+                    v += r[dy + 1][x + dx] * k(dx, dy);
+                }
+            }
 
-            out[i++] = v;
+            dst[x] = v;
         }
     }
 }
@@ -1,5 +1,9 @@
 /*
- * Optimized version of convolution.hpp. Do not include directly.
+ * 5x5 convolution with extend border. Do not include directly.
+ *
+ * The five input rows around each output row are kept in a
+ * border::RowWindow ring buffer, with the border replicated two pixels to
+ * each side, so that the taps never need to clamp coordinates.
  */
 
 #include "algorithm/convolution.hpp"
@@ -10,8 +14,9 @@ namespace iptsd::alg::conv::impl {
 template<typename T, typename S>
 void conv_5x5_extend(Image<T>& out, Image<T> const& data, Kernel<S, 5, 5> const& kern)
 {
+    assert(out.size() == data.size());
+
     // strides
-    auto const stride_d = data.stride();
     auto const stride_k = kern.stride();
 
     // access helpers
@@ -19,955 +24,25 @@ void conv_5x5_extend(Image<T>& out, Image<T> const& data, Kernel<S, 5, 5> const&
         return kern[12 + dy * stride_k + dx];
     };
 
-    auto const d = [&](index_t i, index_t dx, index_t dy) constexpr -> T {
-        return data[i + dy * stride_d + dx];
-    };
+    auto rows = border::RowWindow<border::Extend, 2, T> { data };
 
     // processing...
-    index_t i = 0;
-
-    // y = 0
-    {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0,  0) * k(-2, -2);      // extended
-            v += d(i,  0,  0) * k(-1, -2);      // extended
-            v += d(i,  0,  0) * k( 0, -2);      // extended
-            v += d(i,  1,  0) * k( 1, -2);      // extended
-            v += d(i,  2,  0) * k( 2, -2);      // extended
-
-            v += d(i,  0,  0) * k(-2, -1);      // extended
-            v += d(i,  0,  0) * k(-1, -1);      // extended
-            v += d(i,  0,  0) * k( 0, -1);      // extended
-            v += d(i,  1,  0) * k( 1, -1);      // extended
-            v += d(i,  2,  0) * k( 2, -1);      // extended
-
-            v += d(i,  0,  0) * k(-2,  0);      // extended
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i,  0,  1) * k(-2,  1);      // extended
-            v += d(i,  0,  1) * k(-1,  1);      // extended
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
+    for (index_t y = 0; y < data.size().y; ++y) {
+        rows.load(y);
 
-            v += d(i,  0,  2) * k(-2,  2);      // extended
-            v += d(i,  0,  2) * k(-1,  2);      // extended
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
+        T const* const r[5] = { rows.row(-2), rows.row(-1), rows.row(0), rows.row(1), rows.row(2) };
+        T* const dst = out.row(y);
 
-            out[i++] = v;
-        }
-
-        // x = 1
-        {
+        for (index_t x = 0; x < data.size().x; ++x) {
             T v = math::num<T>::zero;
 
-            v += d(i, -1,  0) * k(-2, -2);      // extended
-            v += d(i, -1,  0) * k(-1, -2);      // extended
-            v += d(i,  0,  0) * k( 0, -2);      // extended
-            v += d(i,  1,  0) * k( 1, -2);      // extended
-            v += d(i,  2,  0) * k( 2, -2);      // extended
-
-            v += d(i, -1,  0) * k(-2, -1);      // extended
-            v += d(i, -1,  0) * k(-1, -1);      // extended
-            v += d(i,  0,  0) * k( 0, -1);      // extended
-            v += d(i,  1,  0) * k( 1, -1);      // extended
-            v += d(i,  2,  0) * k( 2, -1);      // extended
-
-            v += d(i, -1,  0) * k(-2,  0);      // extended
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -1,  1) * k(-2,  1);      // extended
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -1,  2) * k(-2,  2);      // extended
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // 1 < x < n - 2
-        auto const limit = i + data.size().x - 4;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2,  0) * k(-2, -2);      // extended
-            v += d(i, -1,  0) * k(-1, -2);      // extended
-            v += d(i,  0,  0) * k( 0, -2);      // extended
-            v += d(i,  1,  0) * k( 1, -2);      // extended
-            v += d(i,  2,  0) * k( 2, -2);      // extended
-
-            v += d(i, -2,  0) * k(-2, -1);      // extended
-            v += d(i, -1,  0) * k(-1, -1);      // extended
-            v += d(i,  0,  0) * k( 0, -1);      // extended
-            v += d(i,  1,  0) * k( 1, -1);      // extended
-            v += d(i,  2,  0) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // x = n - 2
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2,  0) * k(-2, -2);      // extended
-            v += d(i, -1,  0) * k(-1, -2);      // extended
-            v += d(i,  0,  0) * k( 0, -2);      // extended
-            v += d(i,  1,  0) * k( 1, -2);      // extended
-            v += d(i,  1,  0) * k( 2, -2);      // extended
-
-            v += d(i, -2,  0) * k(-2, -1);      // extended
-            v += d(i, -1,  0) * k(-1, -1);      // extended
-            v += d(i,  0,  0) * k( 0, -1);      // extended
-            v += d(i,  1,  0) * k( 1, -1);      // extended
-            v += d(i,  1,  0) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  1,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  1,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  1,  2) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2,  0) * k(-2, -2);      // extended
-            v += d(i, -1,  0) * k(-1, -2);      // extended
-            v += d(i,  0,  0) * k( 0, -2);      // extended
-            v += d(i,  0,  0) * k( 1, -2);      // extended
-            v += d(i,  0,  0) * k( 2, -2);      // extended
-
-            v += d(i, -2,  0) * k(-2, -1);      // extended
-            v += d(i, -1,  0) * k(-1, -1);      // extended
-            v += d(i,  0,  0) * k( 0, -1);      // extended
-            v += d(i,  0,  0) * k( 1, -1);      // extended
-            v += d(i,  0,  0) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-            v += d(i,  0,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  0,  1) * k( 1,  1);      // extended
-            v += d(i,  0,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  0,  2) * k( 1,  2);      // extended
-            v += d(i,  0,  2) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-    }
-
-    // y = 1
-    {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -1) * k(-2, -2);      // extended
-            v += d(i,  0, -1) * k(-1, -2);      // extended
-            v += d(i,  0, -1) * k( 0, -2);      // extended
-            v += d(i,  1, -1) * k( 1, -2);      // extended
-            v += d(i,  2, -1) * k( 2, -2);      // extended
-
-            v += d(i,  0, -1) * k(-2, -1);      // extended
-            v += d(i,  0, -1) * k(-1, -1);      // extended
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i,  0,  0) * k(-2,  0);      // extended
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i,  0,  1) * k(-2,  1);      // extended
-            v += d(i,  0,  1) * k(-1,  1);      // extended
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i,  0,  2) * k(-2,  2);      // extended
-            v += d(i,  0,  2) * k(-1,  2);      // extended
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // x = 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -1) * k(-2, -2);      // extended
-            v += d(i, -1, -1) * k(-1, -2);      // extended
-            v += d(i,  0, -1) * k( 0, -2);      // extended
-            v += d(i,  1, -1) * k( 1, -2);      // extended
-            v += d(i,  2, -1) * k( 2, -2);      // extended
-
-            v += d(i, -1, -1) * k(-2, -1);      // extended
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -1,  0) * k(-2,  0);      // extended
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -1,  1) * k(-2,  1);      // extended
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -1,  2) * k(-2,  2);      // extended
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // 1 < x < n - 2
-        auto const limit = i + data.size().x - 4;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -1) * k(-2, -2);      // extended
-            v += d(i, -1, -1) * k(-1, -2);      // extended
-            v += d(i,  0, -1) * k( 0, -2);      // extended
-            v += d(i,  1, -1) * k( 1, -2);      // extended
-            v += d(i,  2, -1) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // x = n - 2
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -1) * k(-2, -2);      // extended
-            v += d(i, -1, -1) * k(-1, -2);      // extended
-            v += d(i,  0, -1) * k( 0, -2);      // extended
-            v += d(i,  1, -1) * k( 1, -2);      // extended
-            v += d(i,  1, -1) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  1, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  1,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  1,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  1,  2) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -1) * k(-2, -2);      // extended
-            v += d(i, -1, -1) * k(-1, -2);      // extended
-            v += d(i,  0, -1) * k( 0, -2);      // extended
-            v += d(i,  0, -1) * k( 1, -2);      // extended
-            v += d(i,  0, -1) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  0, -1) * k( 1, -1);      // extended
-            v += d(i,  0, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-            v += d(i,  0,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  0,  1) * k( 1,  1);      // extended
-            v += d(i,  0,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  0,  2) * k( 1,  2);      // extended
-            v += d(i,  0,  2) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-    }
-
-    // 1 < y < n - 2
-    while (i < data.size().x * (data.size().y - 2)) {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -2) * k(-2, -2);      // extended
-            v += d(i,  0, -2) * k(-1, -2);      // extended
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i,  0, -1) * k(-2, -1);      // extended
-            v += d(i,  0, -1) * k(-1, -1);      // extended
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i,  0,  0) * k(-2,  0);      // extended
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i,  0,  1) * k(-2,  1);      // extended
-            v += d(i,  0,  1) * k(-1,  1);      // extended
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i,  0,  2) * k(-2,  2);      // extended
-            v += d(i,  0,  2) * k(-1,  2);      // extended
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // x = 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -2) * k(-2, -2);      // extended
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i, -1, -1) * k(-2, -1);      // extended
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -1,  0) * k(-2,  0);      // extended
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -1,  1) * k(-2,  1);      // extended
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -1,  2) * k(-2,  2);      // extended
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // 1 < x < n - 2
-        auto const limit = i + data.size().x - 4;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  2,  2) * k( 2,  2);
-
-            out[i++] = v;
-        }
-
-        // x = n - 2
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  1, -2) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  1, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  1,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  1,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  1,  2) * k( 1,  2);
-            v += d(i,  1,  2) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  0, -2) * k( 1, -2);      // extended
-            v += d(i,  0, -2) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  0, -1) * k( 1, -1);      // extended
-            v += d(i,  0, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-            v += d(i,  0,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  0,  1) * k( 1,  1);      // extended
-            v += d(i,  0,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  2) * k(-2,  2);
-            v += d(i, -1,  2) * k(-1,  2);
-            v += d(i,  0,  2) * k( 0,  2);
-            v += d(i,  0,  2) * k( 1,  2);      // extended
-            v += d(i,  0,  2) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-    }
-
-    // y = n - 2
-    {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -2) * k(-2, -2);      // extended
-            v += d(i,  0, -2) * k(-1, -2);      // extended
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i,  0, -1) * k(-2, -1);      // extended
-            v += d(i,  0, -1) * k(-1, -1);      // extended
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i,  0,  0) * k(-2,  0);      // extended
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i,  0,  1) * k(-2,  1);      // extended
-            v += d(i,  0,  1) * k(-1,  1);      // extended
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i,  0,  1) * k(-2,  2);      // extended
-            v += d(i,  0,  1) * k(-1,  2);      // extended
-            v += d(i,  0,  1) * k( 0,  2);      // extended
-            v += d(i,  1,  1) * k( 1,  2);      // extended
-            v += d(i,  2,  1) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -2) * k(-2, -2);      // extended
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i, -1, -1) * k(-2, -1);      // extended
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -1,  0) * k(-2,  0);      // extended
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -1,  1) * k(-2,  1);      // extended
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -1,  1) * k(-2,  2);      // extended
-            v += d(i, -1,  1) * k(-1,  2);      // extended
-            v += d(i,  0,  1) * k( 0,  2);      // extended
-            v += d(i,  1,  1) * k( 1,  2);      // extended
-            v += d(i,  2,  1) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // 1 < x < n - 2
-        auto const limit = i + data.size().x - 4;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  2,  1) * k( 2,  1);
-
-            v += d(i, -2,  1) * k(-2,  2);      // extended
-            v += d(i, -1,  1) * k(-1,  2);      // extended
-            v += d(i,  0,  1) * k( 0,  2);      // extended
-            v += d(i,  1,  1) * k( 1,  2);      // extended
-            v += d(i,  2,  1) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 2
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  1, -2) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  1, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  1,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  1,  1) * k( 1,  1);
-            v += d(i,  1,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  1) * k(-2,  2);      // extended
-            v += d(i, -1,  1) * k(-1,  2);      // extended
-            v += d(i,  0,  1) * k( 0,  2);      // extended
-            v += d(i,  1,  1) * k( 1,  2);      // extended
-            v += d(i,  1,  1) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  0, -2) * k( 1, -2);      // extended
-            v += d(i,  0, -2) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  0, -1) * k( 1, -1);      // extended
-            v += d(i,  0, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-            v += d(i,  0,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  1) * k(-2,  1);
-            v += d(i, -1,  1) * k(-1,  1);
-            v += d(i,  0,  1) * k( 0,  1);
-            v += d(i,  0,  1) * k( 1,  1);      // extended
-            v += d(i,  0,  1) * k( 2,  1);      // extended
-
-            v += d(i, -2,  1) * k(-2,  2);      // extended
-            v += d(i, -1,  1) * k(-1,  2);      // extended
-            v += d(i,  0,  1) * k( 0,  2);      // extended
-            v += d(i,  0,  1) * k( 1,  2);      // extended
-            v += d(i,  0,  1) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-    }
-
-    // y = n - 1
-    {
-        // x = 0
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i,  0, -2) * k(-2, -2);      // extended
-            v += d(i,  0, -2) * k(-1, -2);      // extended
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i,  0, -1) * k(-2, -1);      // extended
-            v += d(i,  0, -1) * k(-1, -1);      // extended
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i,  0,  0) * k(-2,  0);      // extended
-            v += d(i,  0,  0) * k(-1,  0);      // extended
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i,  0,  0) * k(-2,  1);      // extended
-            v += d(i,  0,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  1,  0) * k( 1,  1);      // extended
-            v += d(i,  2,  0) * k( 2,  1);      // extended
-
-            v += d(i,  0,  0) * k(-2,  2);      // extended
-            v += d(i,  0,  0) * k(-1,  2);      // extended
-            v += d(i,  0,  0) * k( 0,  2);      // extended
-            v += d(i,  1,  0) * k( 1,  2);      // extended
-            v += d(i,  2,  0) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -1, -2) * k(-2, -2);      // extended
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i, -1, -1) * k(-2, -1);      // extended
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -1,  0) * k(-2,  0);      // extended
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -1,  0) * k(-2,  1);      // extended
-            v += d(i, -1,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  1,  0) * k( 1,  1);      // extended
-            v += d(i,  2,  0) * k( 2,  1);      // extended
-
-            v += d(i, -1,  0) * k(-2,  2);      // extended
-            v += d(i, -1,  0) * k(-1,  2);      // extended
-            v += d(i,  0,  0) * k( 0,  2);      // extended
-            v += d(i,  1,  0) * k( 1,  2);      // extended
-            v += d(i,  2,  0) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // 1 < x < n - 2
-        auto const limit = i + data.size().x - 4;
-        while (i < limit) {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  2, -2) * k( 2, -2);
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  2, -1) * k( 2, -1);
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  2,  0) * k( 2,  0);
-
-            v += d(i, -2,  0) * k(-2,  1);      // extended
-            v += d(i, -1,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  1,  0) * k( 1,  1);      // extended
-            v += d(i,  2,  0) * k( 2,  1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  2);      // extended
-            v += d(i, -1,  0) * k(-1,  2);      // extended
-            v += d(i,  0,  0) * k( 0,  2);      // extended
-            v += d(i,  1,  0) * k( 1,  2);      // extended
-            v += d(i,  2,  0) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 2
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  1, -2) * k( 1, -2);
-            v += d(i,  1, -2) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  1, -1) * k( 1, -1);
-            v += d(i,  1, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  1,  0) * k( 1,  0);
-            v += d(i,  1,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  0) * k(-2,  1);      // extended
-            v += d(i, -1,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  1,  0) * k( 1,  1);      // extended
-            v += d(i,  1,  0) * k( 2,  1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  2);      // extended
-            v += d(i, -1,  0) * k(-1,  2);      // extended
-            v += d(i,  0,  0) * k( 0,  2);      // extended
-            v += d(i,  1,  0) * k( 1,  2);      // extended
-            v += d(i,  1,  0) * k( 2,  2);      // extended
-
-            out[i++] = v;
-        }
-
-        // x = n - 1
-        {
-            T v = math::num<T>::zero;
-
-            v += d(i, -2, -2) * k(-2, -2);
-            v += d(i, -1, -2) * k(-1, -2);
-            v += d(i,  0, -2) * k( 0, -2);
-            v += d(i,  0, -2) * k( 1, -2);      // extended
-            v += d(i,  0, -2) * k( 2, -2);      // extended
-
-            v += d(i, -2, -1) * k(-2, -1);
-            v += d(i, -1, -1) * k(-1, -1);
-            v += d(i,  0, -1) * k( 0, -1);
-            v += d(i,  0, -1) * k( 1, -1);      // extended
-            v += d(i,  0, -1) * k( 2, -1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  0);
-            v += d(i, -1,  0) * k(-1,  0);
-            v += d(i,  0,  0) * k( 0,  0);
-            v += d(i,  0,  0) * k( 1,  0);      // extended
-            v += d(i,  0,  0) * k( 2,  0);      // extended
-
-            v += d(i, -2,  0) * k(-2,  1);      // extended
-            v += d(i, -1,  0) * k(-1,  1);      // extended
-            v += d(i,  0,  0) * k( 0,  1);      // extended
-            v += d(i,  0,  0) * k( 1,  1);      // extended
-            v += d(i,  0,  0) * k( 2,  1);      // extended
-
-            v += d(i, -2,  0) * k(-2,  2);      // extended
-            v += d(i, -1,  0) * k(-1,  2);      // extended
-            v += d(i,  0,  0) * k( 0,  2);      // extended
-            v += d(i,  0,  0) * k( 1,  2);      // extended
-            v += d(i,  0,  0) * k( 2,  2);      // extended
+            for (index_t dy = -2; dy <= 2; ++dy) {
+                for (index_t dx = -2; dx <= 2; ++dx) {
+                    v += r[dy + 2][x + dx] * k(dx, dy);
+                }
+            }
 
-            out[i++] = v;
+            dst[x] = v;
         }
     }
 }
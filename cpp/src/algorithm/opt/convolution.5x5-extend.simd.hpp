@@ -0,0 +1,221 @@
+/*
+ * SIMD version of convolution.5x5-extend.hpp. Do not include directly.
+ *
+ * Images of f32 and Mat2s<f32> are both handled as interleaved f32 planes
+ * with C channels per pixel. Rows are processed in full vector registers,
+ * with the row indices clamped beforehand. Only the two-pixel border on the
+ * left and right is handled by a scalar loop that clamps coordinates.
+ */
+
+#include "algorithm/convolution.hpp"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg::conv::impl {
+
+template<typename T, typename S>
+inline constexpr bool simd_5x5_extend_v =
+#if defined(__AVX2__)
+    std::is_same_v<S, f32> && (std::is_same_v<T, f32> || std::is_same_v<T, Mat2s<f32>>);
+#else
+    false;
+#endif
+
+template<typename T>
+inline constexpr index_t simd_channels_v = sizeof(T) / sizeof(f32);
+
+
+namespace simd5x5 {
+
+template<index_t C>
+inline void pixel(f32* out, f32 const* in, index2_t size, Kernel<f32, 5, 5> const& k,
+                  index_t x, index_t y)
+{
+    index_t ox[5];
+    index_t oy[5];
+
+    for (index_t i = 0; i < 5; ++i) {
+        ox[i] = std::clamp(x + i - 2, 0, size.x - 1) * C;
+        oy[i] = std::clamp(y + i - 2, 0, size.y - 1) * size.x * C;
+    }
+
+    for (index_t c = 0; c < C; ++c) {
+        f32 v = 0.0f;
+
+        for (index_t ky = 0; ky < 5; ++ky) {
+            for (index_t kx = 0; kx < 5; ++kx) {
+                v += in[oy[ky] + ox[kx] + c] * k[ky * 5 + kx];
+            }
+        }
+
+        out[(y * size.x + x) * C + c] = v;
+    }
+}
+
+template<index_t C>
+inline void row_border(f32* out, f32 const* in, index2_t size, Kernel<f32, 5, 5> const& k, index_t y)
+{
+    for (index_t x = 0; x < size.x; ++x) {
+        pixel<C>(out, in, size, k, x, y);
+    }
+}
+
+#if defined(__AVX2__)
+
+inline auto fmadd(__m256 a, __m256 b, __m256 c) -> __m256
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+#endif
+
+/*
+ * Interior of row y, i.e. floats [2 * C, (size.x - 2) * C) of that row. Rows
+ * outside of the image are clamped, so this works for all y.
+ */
+template<index_t C>
+inline void row_interior(f32* out, f32 const* in, index2_t size, Kernel<f32, 5, 5> const& k, index_t y)
+{
+    index_t const stride = size.x * C;
+    index_t const end = (size.x - 2) * C;
+
+    f32 const* const rows[5] = {
+        in + std::clamp(y - 2, 0, size.y - 1) * stride,
+        in + std::clamp(y - 1, 0, size.y - 1) * stride,
+        in + y * stride,
+        in + std::clamp(y + 1, 0, size.y - 1) * stride,
+        in + std::clamp(y + 2, 0, size.y - 1) * stride,
+    };
+
+    f32* const dst = out + y * stride;
+
+    index_t f = 2 * C;
+
+#if defined(__AVX512F__)
+    {
+        __m512 kv[25];
+        for (index_t i = 0; i < 25; ++i) {
+            kv[i] = _mm512_set1_ps(k[i]);
+        }
+
+        for (; f + 16 <= end; f += 16) {
+            // one accumulator per kernel row to break up the dependency chain
+            auto const row = [&](index_t ky) {
+                f32 const* const r = rows[ky] + f;
+
+                auto v = _mm512_mul_ps(_mm512_loadu_ps(r - 2 * C), kv[ky * 5 + 0]);
+                v = _mm512_fmadd_ps(_mm512_loadu_ps(r - 1 * C), kv[ky * 5 + 1], v);
+                v = _mm512_fmadd_ps(_mm512_loadu_ps(r),         kv[ky * 5 + 2], v);
+                v = _mm512_fmadd_ps(_mm512_loadu_ps(r + 1 * C), kv[ky * 5 + 3], v);
+                v = _mm512_fmadd_ps(_mm512_loadu_ps(r + 2 * C), kv[ky * 5 + 4], v);
+                return v;
+            };
+
+            auto const v0 = row(0);
+            auto const v1 = row(1);
+            auto const v2 = row(2);
+            auto const v3 = row(3);
+            auto const v4 = row(4);
+
+            auto const v = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(v0, v1), v4), _mm512_add_ps(v2, v3));
+
+            _mm512_storeu_ps(dst + f, v);
+        }
+    }
+#endif
+
+#if defined(__AVX2__)
+    {
+        __m256 kv[25];
+        for (index_t i = 0; i < 25; ++i) {
+            kv[i] = _mm256_set1_ps(k[i]);
+        }
+
+        for (; f + 8 <= end; f += 8) {
+            // one accumulator per kernel row to break up the dependency chain
+            auto const row = [&](index_t ky) {
+                f32 const* const r = rows[ky] + f;
+
+                auto v = _mm256_mul_ps(_mm256_loadu_ps(r - 2 * C), kv[ky * 5 + 0]);
+                v = fmadd(_mm256_loadu_ps(r - 1 * C), kv[ky * 5 + 1], v);
+                v = fmadd(_mm256_loadu_ps(r),         kv[ky * 5 + 2], v);
+                v = fmadd(_mm256_loadu_ps(r + 1 * C), kv[ky * 5 + 3], v);
+                v = fmadd(_mm256_loadu_ps(r + 2 * C), kv[ky * 5 + 4], v);
+                return v;
+            };
+
+            auto const v0 = row(0);
+            auto const v1 = row(1);
+            auto const v2 = row(2);
+            auto const v3 = row(3);
+            auto const v4 = row(4);
+
+            auto const v = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(v0, v1), v4), _mm256_add_ps(v2, v3));
+
+            _mm256_storeu_ps(dst + f, v);
+        }
+    }
+#endif
+
+    // remainder, less than one vector
+    for (; f < end; ++f) {
+        f32 v = 0.0f;
+
+        for (index_t ky = 0; ky < 5; ++ky) {
+            for (index_t kx = 0; kx < 5; ++kx) {
+                v += rows[ky][f + (kx - 2) * C] * k[ky * 5 + kx];
+            }
+        }
+
+        dst[f] = v;
+    }
+}
+
+} /* namespace simd5x5 */
+
+
+template<typename T, typename S>
+void conv_5x5_extend_simd(Image<T>& out, Image<T> const& data, Kernel<S, 5, 5> const& kern)
+{
+    using namespace simd5x5;
+
+    constexpr index_t C = simd_channels_v<T>;
+
+    static_assert(sizeof(T) == C * sizeof(f32));
+
+    assert(out.size() == data.size());
+    assert(out.stride() == out.size().x);
+    assert(data.stride() == data.size().x);
+
+    auto const size = data.size();
+
+    auto* const dst = reinterpret_cast<f32*>(out.data());
+    auto const* const src = reinterpret_cast<f32 const*>(data.data());
+
+    // too small for an interior, everything is border
+    if (size.x < 5) {
+        for (index_t y = 0; y < size.y; ++y) {
+            row_border<C>(dst, src, size, kern, y);
+        }
+        return;
+    }
+
+    for (index_t y = 0; y < size.y; ++y) {
+        pixel<C>(dst, src, size, kern, 0, y);
+        pixel<C>(dst, src, size, kern, 1, y);
+
+        row_interior<C>(dst, src, size, kern, y);
+
+        pixel<C>(dst, src, size, kern, size.x - 2, y);
+        pixel<C>(dst, src, size, kern, size.x - 1, y);
+    }
+}
+
+} /* namespace iptsd::alg::conv::impl */
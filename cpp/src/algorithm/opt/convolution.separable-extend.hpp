@@ -0,0 +1,253 @@
+/*
+ * Two-pass convolution with separable kernel and extend border. Do not
+ * include directly.
+ *
+ * Each output row is computed by first applying the column vector to the
+ * (clamped) input rows, writing the result to a single row buffer, and then
+ * applying the row vector to that buffer. The buffer is extended by the
+ * kernel radius on both sides, so the horizontal pass needs no border
+ * handling. Input and output may have padded rows (see Layout). Pixels are
+ * handled as interleaved planes of C scalars, so both passes run over
+ * contiguous memory. This also allows convolving multiple images at once by
+ * packing them into a single image of std::array.
+ */
+
+#include "algorithm/convolution.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg::conv::impl {
+namespace sep {
+
+template<typename T>
+struct flat {
+    using type = T;
+    static constexpr index_t channels = 1;
+};
+
+template<typename T>
+struct flat<Mat2s<T>> {
+    using type = T;
+    static constexpr index_t channels = 3;
+};
+
+template<typename T, std::size_t N>
+struct flat<std::array<T, N>> {
+    using type = typename flat<T>::type;
+    static constexpr index_t channels = static_cast<index_t>(N) * flat<T>::channels;
+};
+
+template<typename T>
+using flat_t = typename flat<T>::type;
+
+template<typename T>
+inline constexpr index_t flat_channels_v = flat<T>::channels;
+
+
+#if defined(__AVX2__)
+
+inline auto fmadd(__m256 a, __m256 b, __m256 c) -> __m256
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+#endif
+
+
+/*
+ * Vertical pass: Apply column vector to row y, n scalars per row, with rows
+ * being stride scalars apart.
+ */
+template<typename E, typename S, index_t Ny>
+inline void pass_y(E* tmp, E const* in, index_t n, index_t stride, index_t y, index_t ny,
+                   Kernel<S, 1, Ny> const& k)
+{
+    constexpr index_t d = (Ny - 1) / 2;
+
+    E const* rows[Ny];
+    for (index_t j = 0; j < Ny; ++j) {
+        rows[j] = in + std::clamp(y + j - d, 0, ny - 1) * stride;
+    }
+
+    index_t f = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<E, f32> && std::is_same_v<S, f32>) {
+        __m256 kv[Ny];
+        for (index_t j = 0; j < Ny; ++j) {
+            kv[j] = _mm256_set1_ps(k[j]);
+        }
+
+        for (; f + 8 <= n; f += 8) {
+            auto v = _mm256_mul_ps(_mm256_loadu_ps(rows[0] + f), kv[0]);
+
+            for (index_t j = 1; j < Ny; ++j) {
+                v = fmadd(_mm256_loadu_ps(rows[j] + f), kv[j], v);
+            }
+
+            _mm256_storeu_ps(tmp + f, v);
+        }
+    }
+#endif
+
+    for (; f < n; ++f) {
+        E v = rows[0][f] * k[0];
+
+        for (index_t j = 1; j < Ny; ++j) {
+            v += rows[j][f] * k[j];
+        }
+
+        tmp[f] = v;
+    }
+}
+
+/*
+ * Extend the buffered row of nx pixels by d pixels on both sides, by
+ * replicating the first and last pixel.
+ */
+template<index_t C, typename E>
+inline void extend_row(E* tmp, index_t nx, index_t d)
+{
+    for (index_t x = 1; x <= d; ++x) {
+        for (index_t c = 0; c < C; ++c) {
+            tmp[-x * C + c] = tmp[c];
+            tmp[(nx - 1 + x) * C + c] = tmp[(nx - 1) * C + c];
+        }
+    }
+}
+
+/*
+ * Horizontal pass: Apply row vector to a buffered row of nx pixels. The
+ * buffer must be extended by the kernel radius on both sides, so that no
+ * clamping is required.
+ */
+template<index_t C, typename E, typename S, index_t Nx>
+inline void pass_x(E* out, E const* tmp, index_t nx, Kernel<S, Nx, 1> const& k)
+{
+    constexpr index_t d = (Nx - 1) / 2;
+
+    E const* const base = tmp - d * C;
+
+    index_t f = 0;
+    index_t const end = nx * C;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<E, f32> && std::is_same_v<S, f32>) {
+        __m256 kv[Nx];
+        for (index_t i = 0; i < Nx; ++i) {
+            kv[i] = _mm256_set1_ps(k[i]);
+        }
+
+        for (; f + 8 <= end; f += 8) {
+            auto v = _mm256_mul_ps(_mm256_loadu_ps(base + f), kv[0]);
+
+            for (index_t i = 1; i < Nx; ++i) {
+                v = fmadd(_mm256_loadu_ps(base + f + i * C), kv[i], v);
+            }
+
+            _mm256_storeu_ps(out + f, v);
+        }
+    }
+#endif
+
+    for (; f < end; ++f) {
+        E v = base[f] * k[0];
+
+        for (index_t i = 1; i < Nx; ++i) {
+            v += base[f + i * C] * k[i];
+        }
+
+        out[f] = v;
+    }
+}
+
+/*
+ * Convolve an image of size.x * C scalars per row, with input and output rows
+ * being src_stride and dst_stride scalars apart. The row operator is called
+ * as row_op(row, n) with the n scalars of each output row directly after it
+ * has been written, i.e. while it is still in cache. It may modify the row.
+ */
+template<index_t C, typename E, typename S, index_t Nx, index_t Ny, typename F>
+void run(E* dst, index_t dst_stride, E const* src, index_t src_stride, index2_t size,
+         SeparableKernel<S, Nx, Ny> const& k, F row_op)
+{
+    // row buffer on the stack, only fall back to the heap for very wide images
+    constexpr index_t stack_len = 16384 / sizeof(E);
+    constexpr index_t d = (Nx - 1) / 2;
+
+    assert(dst != src);
+
+    auto const n = size.x * C;
+    auto const len = n + 2 * d * C;
+
+    E buf_stack[stack_len];
+    auto buf_heap = std::vector<E>{};
+
+    E* buf = buf_stack;
+    if (len > stack_len) {
+        buf_heap.resize(len);
+        buf = buf_heap.data();
+    }
+
+    E* const tmp = buf + d * C;
+
+    for (index_t y = 0; y < size.y; ++y) {
+        E* const row = dst + y * dst_stride;
+
+        pass_y(tmp, src, n, src_stride, y, size.y, k.y);
+        extend_row<C>(tmp, size.x, d);
+        pass_x<C>(row, tmp, size.x, k.x);
+
+        row_op(row, n);
+    }
+}
+
+} /* namespace sep */
+
+
+template<typename T, typename S, index_t Nx, index_t Ny, typename F>
+void conv_separable_extend(Image<T>& out, Image<T> const& in, SeparableKernel<S, Nx, Ny> const& k,
+                           F row_op)
+{
+    using E = sep::flat_t<T>;
+
+    constexpr index_t C = sep::flat_channels_v<T>;
+
+    static_assert(sizeof(T) == C * sizeof(E));
+
+    assert(out.size() == in.size());
+
+    auto* const dst = reinterpret_cast<E*>(out.data());
+    auto const* const src = reinterpret_cast<E const*>(in.data());
+
+    sep::run<C>(dst, out.stride() * C, src, in.stride() * C, in.size(), k, row_op);
+}
+
+template<typename T, typename S, index_t Nx, index_t Ny>
+void conv_separable_extend(Image<T>& out, Image<T> const& in, SeparableKernel<S, Nx, Ny> const& k)
+{
+    conv_separable_extend<T, S, Nx, Ny>(out, in, k, [](auto*, index_t) {});
+}
+
+/*
+ * Planar tensor images are convolved plane by plane.
+ */
+template<typename T, typename S, index_t Nx, index_t Ny>
+void conv_separable_extend(TensorImage<T>& out, TensorImage<T> const& in, SeparableKernel<S, Nx, Ny> const& k)
+{
+    assert(out.size() == in.size());
+
+    for (index_t c = 0; c < 3; ++c) {
+        sep::run<1>(out.plane(c), out.stride(), in.plane(c), in.stride(), in.size(), k,
+                    [](auto*, index_t) {});
+    }
+}
+
+} /* namespace iptsd::alg::conv::impl */
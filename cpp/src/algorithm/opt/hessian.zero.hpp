@@ -1,5 +1,10 @@
 /*
- * Optimized version of hessian.hpp. Do not include directly.
+ * Hessian via the 3x3 Sobel kernels, with zero border. Do not include
+ * directly.
+ *
+ * All three second derivatives are accumulated in one pass over a
+ * border::RowWindow of radius one, with pixels outside of the image read
+ * as zero.
  */
 
 #include "algorithm/hessian.hpp"
@@ -16,7 +21,6 @@ void hessian_zero(Image<Mat2s<T>>& out, Image<T> const& in)
     auto const& kxy = conv::kernels::sobel3_xy<T>;
 
     // strides
-    auto const stride_d = in.stride();
     auto const stride_k = 3;
 
     // access helpers
@@ -24,279 +28,30 @@ void hessian_zero(Image<Mat2s<T>>& out, Image<T> const& in)
         return kern[4 + dy * stride_k + dx];
     };
 
-    auto const d = [&](index_t i, index_t dx, index_t dy) constexpr -> T {
-        return in[i + dy * stride_d + dx];
-    };
+    auto rows = border::RowWindow<border::Zero, 1, T> { in };
 
     // processing...
-    index_t i = 0;
-
-    // x = 0, y = 0
-    {
-        auto h = math::num<Mat2s<T>>::zero;
-
-        h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-        h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-        h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-        h.xx += d(i,  1,  0) * k(kxx,  1,  0);
-        h.xy += d(i,  1,  0) * k(kxy,  1,  0);
-        h.yy += d(i,  1,  0) * k(kyy,  1,  0);
-
-        h.xx += d(i,  0,  1) * k(kxx,  0,  1);
-        h.xy += d(i,  0,  1) * k(kxy,  0,  1);
-        h.yy += d(i,  0,  1) * k(kyy,  0,  1);
-
-        h.xx += d(i,  1,  1) * k(kxx,  1,  1);
-        h.xy += d(i,  1,  1) * k(kxy,  1,  1);
-        h.yy += d(i,  1,  1) * k(kyy,  1,  1);
-
-        out[i] = h;
-    }
-    ++i;
-
-    // 0 < x < n - 1, y = 0
-    for (; i < in.size().x - 1; ++i) {
-        auto h = math::num<Mat2s<T>>::zero;
-
-        h.xx += d(i, -1,  0) * k(kxx, -1,  0);
-        h.xy += d(i, -1,  0) * k(kxy, -1,  0);
-        h.yy += d(i, -1,  0) * k(kyy, -1,  0);
-
-        h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-        h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-        h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-        h.xx += d(i,  1,  0) * k(kxx,  1,  0);
-        h.xy += d(i,  1,  0) * k(kxy,  1,  0);
-        h.yy += d(i,  1,  0) * k(kyy,  1,  0);
-
-        h.xx += d(i, -1,  1) * k(kxx, -1,  1);
-        h.xy += d(i, -1,  1) * k(kxy, -1,  1);
-        h.yy += d(i, -1,  1) * k(kyy, -1,  1);
-
-        h.xx += d(i,  0,  1) * k(kxx,  0,  1);
-        h.xy += d(i,  0,  1) * k(kxy,  0,  1);
-        h.yy += d(i,  0,  1) * k(kyy,  0,  1);
-
-        h.xx += d(i,  1,  1) * k(kxx,  1,  1);
-        h.xy += d(i,  1,  1) * k(kxy,  1,  1);
-        h.yy += d(i,  1,  1) * k(kyy,  1,  1);
-
-        out[i] = h;
-    }
-
-    // x = n - 1, y = 0
-    {
-        auto h = math::num<Mat2s<T>>::zero;
-
-        h.xx += d(i, -1,  0) * k(kxx, -1,  0);
-        h.xy += d(i, -1,  0) * k(kxy, -1,  0);
-        h.yy += d(i, -1,  0) * k(kyy, -1,  0);
+    for (index_t y = 0; y < in.size().y; ++y) {
+        rows.load(y);
 
-        h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-        h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-        h.yy += d(i,  0,  0) * k(kyy,  0,  0);
+        T const* const r[3] = { rows.row(-1), rows.row(0), rows.row(1) };
+        Mat2s<T>* const dst = out.row(y);
 
-        h.xx += d(i, -1,  1) * k(kxx, -1,  1);
-        h.xy += d(i, -1,  1) * k(kxy, -1,  1);
-        h.yy += d(i, -1,  1) * k(kyy, -1,  1);
-
-        h.xx += d(i,  0,  1) * k(kxx,  0,  1);
-        h.xy += d(i,  0,  1) * k(kxy,  0,  1);
-        h.yy += d(i,  0,  1) * k(kyy,  0,  1);
-
-        out[i] = h;
-    }
-    ++i;
-
-    // 0 < y < n - 1
-    while (i < in.size().x * (in.size().y - 1)) {
-        // x = 0
-        {
+        for (index_t x = 0; x < in.size().x; ++x) {
             auto h = math::num<Mat2s<T>>::zero;
 
-            h.xx += d(i,  0, -1) * k(kxx,  0, -1);
-            h.xy += d(i,  0, -1) * k(kxy,  0, -1);
-            h.yy += d(i,  0, -1) * k(kyy,  0, -1);
-
-            h.xx += d(i,  1, -1) * k(kxx,  1, -1);
-            h.xy += d(i,  1, -1) * k(kxy,  1, -1);
-            h.yy += d(i,  1, -1) * k(kyy,  1, -1);
+            for (index_t dy = -1; dy <= 1; ++dy) {
+                for (index_t dx = -1; dx <= 1; ++dx) {
+                    auto const d = r[dy + 1][x + dx];
 
-            h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-            h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-            h.yy += d(i,  0,  0) * k(kyy,  0,  0);
+                    h.xx += d * k(kxx, dx, dy);
+                    h.xy += d * k(kxy, dx, dy);
+                    h.yy += d * k(kyy, dx, dy);
+                }
+            }
 
-            h.xx += d(i,  1,  0) * k(kxx,  1,  0);
-            h.xy += d(i,  1,  0) * k(kxy,  1,  0);
-            h.yy += d(i,  1,  0) * k(kyy,  1,  0);
-
-            h.xx += d(i,  0,  1) * k(kxx,  0,  1);
-            h.xy += d(i,  0,  1) * k(kxy,  0,  1);
-            h.yy += d(i,  0,  1) * k(kyy,  0,  1);
-
-            h.xx += d(i,  1,  1) * k(kxx,  1,  1);
-            h.xy += d(i,  1,  1) * k(kxy,  1,  1);
-            h.yy += d(i,  1,  1) * k(kyy,  1,  1);
-
-            out[i] = h;
+            dst[x] = h;
         }
-        ++i;
-
-        // 0 < x < n - 1
-        auto const limit = i + in.size().x - 2;
-        for (; i < limit; ++i) {
-            auto h = math::num<Mat2s<T>>::zero;
-
-            h.xx += d(i, -1, -1) * k(kxx, -1, -1);
-            h.xy += d(i, -1, -1) * k(kxy, -1, -1);
-            h.yy += d(i, -1, -1) * k(kyy, -1, -1);
-
-            h.xx += d(i,  0, -1) * k(kxx,  0, -1);
-            h.xy += d(i,  0, -1) * k(kxy,  0, -1);
-            h.yy += d(i,  0, -1) * k(kyy,  0, -1);
-
-            h.xx += d(i,  1, -1) * k(kxx,  1, -1);
-            h.xy += d(i,  1, -1) * k(kxy,  1, -1);
-            h.yy += d(i,  1, -1) * k(kyy,  1, -1);
-
-            h.xx += d(i, -1,  0) * k(kxx, -1,  0);
-            h.xy += d(i, -1,  0) * k(kxy, -1,  0);
-            h.yy += d(i, -1,  0) * k(kyy, -1,  0);
-
-            h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-            h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-            h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-            h.xx += d(i,  1,  0) * k(kxx,  1,  0);
-            h.xy += d(i,  1,  0) * k(kxy,  1,  0);
-            h.yy += d(i,  1,  0) * k(kyy,  1,  0);
-
-            h.xx += d(i, -1,  1) * k(kxx, -1,  1);
-            h.xy += d(i, -1,  1) * k(kxy, -1,  1);
-            h.yy += d(i, -1,  1) * k(kyy, -1,  1);
-
-            h.xx += d(i,  0,  1) * k(kxx,  0,  1);
-            h.xy += d(i,  0,  1) * k(kxy,  0,  1);
-            h.yy += d(i,  0,  1) * k(kyy,  0,  1);
-
-            h.xx += d(i,  1,  1) * k(kxx,  1,  1);
-            h.xy += d(i,  1,  1) * k(kxy,  1,  1);
-            h.yy += d(i,  1,  1) * k(kyy,  1,  1);
-
-            out[i] = h;
-        }
-
-        // x = n - 1
-        {
-            auto h = math::num<Mat2s<T>>::zero;
-
-            h.xx += d(i, -1, -1) * k(kxx, -1, -1);
-            h.xy += d(i, -1, -1) * k(kxy, -1, -1);
-            h.yy += d(i, -1, -1) * k(kyy, -1, -1);
-
-            h.xx += d(i,  0, -1) * k(kxx,  0, -1);
-            h.xy += d(i,  0, -1) * k(kxy,  0, -1);
-            h.yy += d(i,  0, -1) * k(kyy,  0, -1);
-
-            h.xx += d(i, -1,  0) * k(kxx, -1,  0);
-            h.xy += d(i, -1,  0) * k(kxy, -1,  0);
-            h.yy += d(i, -1,  0) * k(kyy, -1,  0);
-
-            h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-            h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-            h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-            h.xx += d(i, -1,  1) * k(kxx, -1,  1);
-            h.xy += d(i, -1,  1) * k(kxy, -1,  1);
-            h.yy += d(i, -1,  1) * k(kyy, -1,  1);
-
-            h.xx += d(i,  0,  1) * k(kxx,  0,  1);
-            h.xy += d(i,  0,  1) * k(kxy,  0,  1);
-            h.yy += d(i,  0,  1) * k(kyy,  0,  1);
-
-            out[i] = h;
-        }
-        ++i;
-    }
-
-    // x = 0, y = n - 1
-    {
-        auto h = math::num<Mat2s<T>>::zero;
-
-        h.xx += d(i,  0, -1) * k(kxx,  0, -1);
-        h.xy += d(i,  0, -1) * k(kxy,  0, -1);
-        h.yy += d(i,  0, -1) * k(kyy,  0, -1);
-
-        h.xx += d(i,  1, -1) * k(kxx,  1, -1);
-        h.xy += d(i,  1, -1) * k(kxy,  1, -1);
-        h.yy += d(i,  1, -1) * k(kyy,  1, -1);
-
-        h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-        h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-        h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-        h.xx += d(i,  1,  0) * k(kxx,  1,  0);
-        h.xy += d(i,  1,  0) * k(kxy,  1,  0);
-        h.yy += d(i,  1,  0) * k(kyy,  1,  0);
-
-        out[i] = h;
-    }
-    ++i;
-
-    // 0 < x < n - 1, y = n - 1
-    for (; i < in.size().span() - 1; ++i) {
-        auto h = math::num<Mat2s<T>>::zero;
-
-        h.xx += d(i, -1, -1) * k(kxx, -1, -1);
-        h.xy += d(i, -1, -1) * k(kxy, -1, -1);
-        h.yy += d(i, -1, -1) * k(kyy, -1, -1);
-
-        h.xx += d(i,  0, -1) * k(kxx,  0, -1);
-        h.xy += d(i,  0, -1) * k(kxy,  0, -1);
-        h.yy += d(i,  0, -1) * k(kyy,  0, -1);
-
-        h.xx += d(i,  1, -1) * k(kxx,  1, -1);
-        h.xy += d(i,  1, -1) * k(kxy,  1, -1);
-        h.yy += d(i,  1, -1) * k(kyy,  1, -1);
-
-        h.xx += d(i, -1,  0) * k(kxx, -1,  0);
-        h.xy += d(i, -1,  0) * k(kxy, -1,  0);
-        h.yy += d(i, -1,  0) * k(kyy, -1,  0);
-
-        h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-        h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-        h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-        h.xx += d(i,  1,  0) * k(kxx,  1,  0);
-        h.xy += d(i,  1,  0) * k(kxy,  1,  0);
-        h.yy += d(i,  1,  0) * k(kyy,  1,  0);
-
-        out[i] = h;
-    }
-
-    // x = n - 1, y = n - 1
-    {
-        auto h = math::num<Mat2s<T>>::zero;
-
-        h.xx += d(i, -1, -1) * k(kxx, -1, -1);
-        h.xy += d(i, -1, -1) * k(kxy, -1, -1);
-        h.yy += d(i, -1, -1) * k(kyy, -1, -1);
-
-        h.xx += d(i,  0, -1) * k(kxx,  0, -1);
-        h.xy += d(i,  0, -1) * k(kxy,  0, -1);
-        h.yy += d(i,  0, -1) * k(kyy,  0, -1);
-
-        h.xx += d(i, -1,  0) * k(kxx, -1,  0);
-        h.xy += d(i, -1,  0) * k(kxy, -1,  0);
-        h.yy += d(i, -1,  0) * k(kyy, -1,  0);
-
-        h.xx += d(i,  0,  0) * k(kxx,  0,  0);
-        h.xy += d(i,  0,  0) * k(kxy,  0,  0);
-        h.yy += d(i,  0,  0) * k(kyy,  0,  0);
-
-        out[i] = h;
     }
 }
 
@@ -1,5 +1,10 @@
 /*
- * Optimized version of structure_tensor.hpp. Do not include directly.
+ * Structure tensor from 3x3 gradient kernels, with zero border. Do not
+ * include directly.
+ *
+ * Both gradients are computed from a single border::RowWindow of radius
+ * one, which supplies zeros outside of the image, and combined into the
+ * tensor right away.
  */
 
 #include "algorithm/structure_tensor.hpp"
@@ -15,7 +20,6 @@ void structure_tensor_3x3_zero(Image<Mat2s<T>>& out, Image<T> const& in,
     assert(kx.stride() == ky.stride());
 
     // strides
-    auto const stride_d = in.stride();
     auto const stride_k = kx.stride();
 
     // access helpers
@@ -23,239 +27,30 @@ void structure_tensor_3x3_zero(Image<Mat2s<T>>& out, Image<T> const& in,
         return kern[4 + dy * stride_k + dx];
     };
 
-    auto const d = [&](index_t i, index_t dx, index_t dy) constexpr -> T {
-        return in[i + dy * stride_d + dx];
-    };
+    auto rows = border::RowWindow<border::Zero, 1, T> { in };
 
     // processing...
-    index_t i = 0;
-
-    // x = 0, y = 0
-    {
-        T gx = math::num<T>::zero;
-        T gy = math::num<T>::zero;
-
-        gx += d(i,  0,  0) * k(kx,  0,  0);
-        gy += d(i,  0,  0) * k(ky,  0,  0);
-
-        gx += d(i,  1,  0) * k(kx,  1,  0);
-        gy += d(i,  1,  0) * k(ky,  1,  0);
-
-        gx += d(i,  0,  1) * k(kx,  0,  1);
-        gy += d(i,  0,  1) * k(ky,  0,  1);
-
-        gx += d(i,  1,  1) * k(kx,  1,  1);
-        gy += d(i,  1,  1) * k(ky,  1,  1);
-
-        out[i] = { gx * gx, gx * gy, gy * gy };
-    }
-    ++i;
-
-    // 0 < x < n - 1, y = 0
-    for (; i < in.size().x - 1; ++i) {
-        T gx = math::num<T>::zero;
-        T gy = math::num<T>::zero;
-
-        gx += d(i, -1,  0) * k(kx, -1,  0);
-        gy += d(i, -1,  0) * k(ky, -1,  0);
-
-        gx += d(i,  0,  0) * k(kx,  0,  0);
-        gy += d(i,  0,  0) * k(ky,  0,  0);
-
-        gx += d(i,  1,  0) * k(kx,  1,  0);
-        gy += d(i,  1,  0) * k(ky,  1,  0);
-
-        gx += d(i, -1,  1) * k(kx, -1,  1);
-        gy += d(i, -1,  1) * k(ky, -1,  1);
-
-        gx += d(i,  0,  1) * k(kx,  0,  1);
-        gy += d(i,  0,  1) * k(ky,  0,  1);
-
-        gx += d(i,  1,  1) * k(kx,  1,  1);
-        gy += d(i,  1,  1) * k(ky,  1,  1);
-
-        out[i] = { gx * gx, gx * gy, gy * gy };
-    }
-
-    // x = n - 1, y = 0
-    {
-        T gx = math::num<T>::zero;
-        T gy = math::num<T>::zero;
-
-        gx += d(i, -1,  0) * k(kx, -1,  0);
-        gy += d(i, -1,  0) * k(ky, -1,  0);
+    for (index_t y = 0; y < in.size().y; ++y) {
+        rows.load(y);
 
-        gx += d(i,  0,  0) * k(kx,  0,  0);
-        gy += d(i,  0,  0) * k(ky,  0,  0);
+        T const* const r[3] = { rows.row(-1), rows.row(0), rows.row(1) };
+        Mat2s<T>* const dst = out.row(y);
 
-        gx += d(i, -1,  1) * k(kx, -1,  1);
-        gy += d(i, -1,  1) * k(ky, -1,  1);
-
-        gx += d(i,  0,  1) * k(kx,  0,  1);
-        gy += d(i,  0,  1) * k(ky,  0,  1);
-
-        out[i] = { gx * gx, gx * gy, gy * gy };
-    }
-    ++i;
-
-    // 0 < y < n - 1
-    while (i < in.size().x * (in.size().y - 1)) {
-        // x = 0
-        {
+        for (index_t x = 0; x < in.size().x; ++x) {
             T gx = math::num<T>::zero;
             T gy = math::num<T>::zero;
 
-            gx += d(i,  0, -1) * k(kx,  0, -1);
-            gy += d(i,  0, -1) * k(ky,  0, -1);
-
-            gx += d(i,  1, -1) * k(kx,  1, -1);
-            gy += d(i,  1, -1) * k(ky,  1, -1);
+            for (index_t dy = -1; dy <= 1; ++dy) {
+                for (index_t dx = -1; dx <= 1; ++dx) {
+                    auto const d = r[dy + 1][x + dx];
 
-            gx += d(i,  0,  0) * k(kx,  0,  0);
-            gy += d(i,  0,  0) * k(ky,  0,  0);
+                    gx += d * k(kx, dx, dy);
+                    gy += d * k(ky, dx, dy);
+                }
+            }
 
-            gx += d(i,  1,  0) * k(kx,  1,  0);
-            gy += d(i,  1,  0) * k(ky,  1,  0);
-
-            gx += d(i,  0,  1) * k(kx,  0,  1);
-            gy += d(i,  0,  1) * k(ky,  0,  1);
-
-            gx += d(i,  1,  1) * k(kx,  1,  1);
-            gy += d(i,  1,  1) * k(ky,  1,  1);
-
-            out[i] = { gx * gx, gx * gy, gy * gy };
+            dst[x] = { gx * gx, gx * gy, gy * gy };
         }
-        ++i;
-
-        // 0 < x < n - 1
-        auto const limit = i + in.size().x - 2;
-        for (; i < limit; ++i) {
-            T gx = math::num<T>::zero;
-            T gy = math::num<T>::zero;
-
-            gx += d(i, -1, -1) * k(kx, -1, -1);
-            gy += d(i, -1, -1) * k(ky, -1, -1);
-
-            gx += d(i,  0, -1) * k(kx,  0, -1);
-            gy += d(i,  0, -1) * k(ky,  0, -1);
-
-            gx += d(i,  1, -1) * k(kx,  1, -1);
-            gy += d(i,  1, -1) * k(ky,  1, -1);
-
-            gx += d(i, -1,  0) * k(kx, -1,  0);
-            gy += d(i, -1,  0) * k(ky, -1,  0);
-
-            gx += d(i,  0,  0) * k(kx,  0,  0);
-            gy += d(i,  0,  0) * k(ky,  0,  0);
-
-            gx += d(i,  1,  0) * k(kx,  1,  0);
-            gy += d(i,  1,  0) * k(ky,  1,  0);
-
-            gx += d(i, -1,  1) * k(kx, -1,  1);
-            gy += d(i, -1,  1) * k(ky, -1,  1);
-
-            gx += d(i,  0,  1) * k(kx,  0,  1);
-            gy += d(i,  0,  1) * k(ky,  0,  1);
-
-            gx += d(i,  1,  1) * k(kx,  1,  1);
-            gy += d(i,  1,  1) * k(ky,  1,  1);
-
-            out[i] = { gx * gx, gx * gy, gy * gy };
-        }
-
-        // x = n - 1
-        {
-            T gx = math::num<T>::zero;
-            T gy = math::num<T>::zero;
-
-            gx += d(i, -1, -1) * k(kx, -1, -1);
-            gy += d(i, -1, -1) * k(ky, -1, -1);
-
-            gx += d(i,  0, -1) * k(kx,  0, -1);
-            gy += d(i,  0, -1) * k(ky,  0, -1);
-
-            gx += d(i, -1,  0) * k(kx, -1,  0);
-            gy += d(i, -1,  0) * k(ky, -1,  0);
-
-            gx += d(i,  0,  0) * k(kx,  0,  0);
-            gy += d(i,  0,  0) * k(ky,  0,  0);
-
-            gx += d(i, -1,  1) * k(kx, -1,  1);
-            gy += d(i, -1,  1) * k(ky, -1,  1);
-
-            gx += d(i,  0,  1) * k(kx,  0,  1);
-            gy += d(i,  0,  1) * k(ky,  0,  1);
-
-            out[i] = { gx * gx, gx * gy, gy * gy };
-        }
-        ++i;
-    }
-
-    // x = 0, y = n - 1
-    {
-        T gx = math::num<T>::zero;
-        T gy = math::num<T>::zero;
-
-        gx += d(i,  0, -1) * k(kx,  0, -1);
-        gy += d(i,  0, -1) * k(ky,  0, -1);
-
-        gx += d(i,  1, -1) * k(kx,  1, -1);
-        gy += d(i,  1, -1) * k(ky,  1, -1);
-
-        gx += d(i,  0,  0) * k(kx,  0,  0);
-        gy += d(i,  0,  0) * k(ky,  0,  0);
-
-        gx += d(i,  1,  0) * k(kx,  1,  0);
-        gy += d(i,  1,  0) * k(ky,  1,  0);
-
-        out[i] = { gx * gx, gx * gy, gy * gy };
-    }
-    ++i;
-
-    // 0 < x < n - 1, y = n - 1
-    for (; i < in.size().span() - 1; ++i) {
-        T gx = math::num<T>::zero;
-        T gy = math::num<T>::zero;
-
-        gx += d(i, -1, -1) * k(kx, -1, -1);
-        gy += d(i, -1, -1) * k(ky, -1, -1);
-
-        gx += d(i,  0, -1) * k(kx,  0, -1);
-        gy += d(i,  0, -1) * k(ky,  0, -1);
-
-        gx += d(i,  1, -1) * k(kx,  1, -1);
-        gy += d(i,  1, -1) * k(ky,  1, -1);
-
-        gx += d(i, -1,  0) * k(kx, -1,  0);
-        gy += d(i, -1,  0) * k(ky, -1,  0);
-
-        gx += d(i,  0,  0) * k(kx,  0,  0);
-        gy += d(i,  0,  0) * k(ky,  0,  0);
-
-        gx += d(i,  1,  0) * k(kx,  1,  0);
-        gy += d(i,  1,  0) * k(ky,  1,  0);
-
-        out[i] = { gx * gx, gx * gy, gy * gy };
-    }
-
-    // x = n - 1, y = n - 1
-    {
-        T gx = math::num<T>::zero;
-        T gy = math::num<T>::zero;
-
-        gx += d(i, -1, -1) * k(kx, -1, -1);
-        gy += d(i, -1, -1) * k(ky, -1, -1);
-
-        gx += d(i,  0, -1) * k(kx,  0, -1);
-        gy += d(i,  0, -1) * k(ky,  0, -1);
-
-        gx += d(i, -1,  0) * k(kx, -1,  0);
-        gy += d(i, -1,  0) * k(ky, -1,  0);
-
-        gx += d(i,  0,  0) * k(kx,  0,  0);
-        gy += d(i,  0,  0) * k(ky,  0,  0);
-
-        out[i] = { gx * gx, gx * gy, gy * gy };
     }
 }
 
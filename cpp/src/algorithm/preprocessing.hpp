@@ -0,0 +1,141 @@
+#pragma once
+
+#include "types.hpp"
+
+#include "container/image.hpp"
+#include "container/kernel.hpp"
+
+#include "algorithm/convolution.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg {
+namespace prep::impl {
+
+#if defined(__AVX2__)
+
+inline auto hsum(__m256 v) -> f32
+{
+    auto const lo = _mm256_castps256_ps128(v);
+    auto const hi = _mm256_extractf128_ps(v, 1);
+
+    auto s = _mm_add_ps(lo, hi);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+
+    return _mm_cvtss_f32(s);
+}
+
+#endif
+
+/*
+ * Sum of a row of n values.
+ */
+inline auto row_sum(f32 const* row, index_t n) -> f32
+{
+    index_t i = 0;
+    f32 sum = 0.0f;
+
+#if defined(__AVX2__)
+    auto acc = _mm256_setzero_ps();
+
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_loadu_ps(row + i));
+    }
+
+    sum = hsum(acc);
+#endif
+
+    for (; i < n; ++i) {
+        sum += row[i];
+    }
+
+    return sum;
+}
+
+/*
+ * Replace each value x of the row by max(x - offs, 0), returns the sum of
+ * the original values.
+ */
+inline auto row_sum_sub_clamp(f32* row, index_t n, f32 offs) -> f32
+{
+    index_t i = 0;
+    f32 sum = 0.0f;
+
+#if defined(__AVX2__)
+    auto const vo = _mm256_set1_ps(offs);
+    auto const vz = _mm256_setzero_ps();
+    auto acc = _mm256_setzero_ps();
+
+    for (; i + 8 <= n; i += 8) {
+        auto const v = _mm256_loadu_ps(row + i);
+
+        acc = _mm256_add_ps(acc, v);
+        _mm256_storeu_ps(row + i, _mm256_max_ps(_mm256_sub_ps(v, vo), vz));
+    }
+
+    sum = hsum(acc);
+#endif
+
+    for (; i < n; ++i) {
+        sum += row[i];
+        row[i] = std::max(row[i] - offs, 0.0f);
+    }
+
+    return sum;
+}
+
+} /* namespace prep::impl */
+
+
+/*
+ * Replace each pixel x by max(x - offs, 0).
+ */
+inline void subtract_clamp(Image<f32>& img, f32 offs)
+{
+    assert(img.stride() == img.size().x);
+
+    prep::impl::row_sum_sub_clamp(img.data(), img.size().span(), offs);
+}
+
+/*
+ * Convolve and return the sum of all output pixels, computed in the same
+ * sweep.
+ */
+template<typename S, index_t Nx, index_t Ny>
+auto convolve_sum(Image<f32>& out, Image<f32> const& in, SeparableKernel<S, Nx, Ny> const& k) -> f32
+{
+    f32 sum = 0.0f;
+
+    convolve(out, in, k, [&](f32* row, index_t n) {
+        sum += prep::impl::row_sum(row, n);
+    });
+
+    return sum;
+}
+
+/*
+ * Convolve and replace each output pixel x by max(x - offs, 0) in the same
+ * sweep. Returns the sum of the output pixels before subtraction, e.g. to
+ * compute the offset for the next frame.
+ */
+template<typename S, index_t Nx, index_t Ny>
+auto convolve_sum_subtract_clamp(Image<f32>& out, Image<f32> const& in,
+                                 SeparableKernel<S, Nx, Ny> const& k, f32 offs) -> f32
+{
+    f32 sum = 0.0f;
+
+    convolve(out, in, k, [&](f32* row, index_t n) {
+        sum += prep::impl::row_sum_sub_clamp(row, n, offs);
+    });
+
+    return sum;
+}
+
+} /* namespace iptsd::alg */
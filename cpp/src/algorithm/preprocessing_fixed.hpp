@@ -0,0 +1,446 @@
+#pragma once
+
+/*
+ * Fixed-point variant of the preprocessing stages, operating directly on the
+ * raw 8 bit heatmap samples.
+ *
+ * Samples are inverted and stored as i16 with sample_bits fractional bits,
+ * i.e. s = (z_max - v) * 2^sample_bits, so that s * scale(z_min, z_max)
+ * equals the float heatmap value 1 - (v - z_min) / (z_max - z_min). Kernel
+ * weights are stored with weight_bits fractional bits and applied via
+ * rounding multiplications, which keeps all intermediate values within i16
+ * and allows processing 16 pixels per AVX2 instruction, twice as many as in
+ * the float pipeline.
+ */
+
+#include "types.hpp"
+
+#include "container/image.hpp"
+#include "container/kernel.hpp"
+
+#include "algorithm/convolution.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg::fixed {
+
+// fractional bits of the samples, differences of 8 bit samples still fit i16
+inline constexpr int sample_bits = 7;
+
+// fractional bits of the kernel weights, as expected by _mm256_mulhrs_epi16
+inline constexpr int weight_bits = 15;
+
+/*
+ * Factor converting fixed-point samples to float heatmap values, or zero if
+ * the range is empty or inverted, in which case the samples carry no
+ * information. HeatmapDecoder decodes such ranges to all zeros as well.
+ */
+inline auto scale(u8 z_min, u8 z_max) -> f32
+{
+    if (z_max <= z_min) {
+        return 0.0f;
+    }
+
+    auto const range = static_cast<int>(z_max) - static_cast<int>(z_min);
+    return 1.0f / static_cast<f32>(range * (1 << sample_bits));
+}
+
+/*
+ * Quantize kernel weights, which must sum up to one. The largest weight is
+ * adjusted so that the quantized weights still sum up to exactly one, i.e.
+ * constant images are preserved. A weight of one (e.g. the identity kernel)
+ * is not representable and saturates to 1 - 2^-weight_bits instead of
+ * wrapping around to -1.
+ */
+template<index_t Nx, index_t Ny>
+auto quantize(Kernel<f32, Nx, Ny> const& k) -> Kernel<i16, Nx, Ny>
+{
+    auto const saturate = [](i32 v) -> i16 {
+        auto const lo = static_cast<i32>(std::numeric_limits<i16>::lowest());
+        auto const hi = static_cast<i32>(std::numeric_limits<i16>::max());
+
+        return static_cast<i16>(std::clamp(v, lo, hi));
+    };
+
+    auto out = Kernel<i16, Nx, Ny>{};
+
+    i32 sum = 0;
+    index_t max = 0;
+
+    for (index_t i = 0; i < Nx * Ny; ++i) {
+        out[i] = saturate(static_cast<i32>(std::lround(k[i] * static_cast<f32>(1 << weight_bits))));
+        sum += out[i];
+
+        if (out[i] > out[max])
+            max = i;
+    }
+
+    out[max] = saturate(out[max] + (1 << weight_bits) - sum);
+    return out;
+}
+
+template<index_t Nx, index_t Ny>
+auto quantize(SeparableKernel<f32, Nx, Ny> const& k) -> SeparableKernel<i16, Nx, Ny>
+{
+    return { quantize(k.x), quantize(k.y) };
+}
+
+
+namespace impl {
+
+/*
+ * Scalar equivalent of _mm256_mulhrs_epi16, i.e. a * w / 2^15, rounded.
+ */
+inline auto mul(i16 a, i16 w) -> i16
+{
+    return static_cast<i16>((static_cast<i32>(a) * w + (1 << (weight_bits - 1))) >> weight_bits);
+}
+
+inline auto sample(u8 v, u8 z_max) -> i16
+{
+    return static_cast<i16>((z_max - v) * (1 << sample_bits));
+}
+
+/*
+ * Convert a row of n raw samples to fixed point.
+ */
+inline void convert_row(i16* out, u8 const* in, index_t n, u8 z_max)
+{
+    index_t x = 0;
+
+#if defined(__AVX2__)
+    auto const vz = _mm256_set1_epi16(z_max);
+
+    for (; x + 16 <= n; x += 16) {
+        auto const r = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + x)));
+        auto const s = _mm256_slli_epi16(_mm256_sub_epi16(vz, r), sample_bits);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), s);
+    }
+#endif
+
+    for (; x < n; ++x) {
+        out[x] = sample(in[x], z_max);
+    }
+}
+
+/*
+ * Vertical pass on converted sample rows, see the float version in
+ * opt/convolution.separable-extend.hpp.
+ */
+template<index_t Ny>
+inline void pass_y(i16* tmp, i16 const* const (&rows)[Ny], index_t n, Kernel<i16, 1, Ny> const& k)
+{
+    index_t x = 0;
+
+#if defined(__AVX2__)
+    __m256i kv[Ny];
+    for (index_t j = 0; j < Ny; ++j) {
+        kv[j] = _mm256_set1_epi16(k[j]);
+    }
+
+    auto const step = [&](index_t x) {
+        auto v = _mm256_setzero_si256();
+
+        for (index_t j = 0; j < Ny; ++j) {
+            auto const r = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rows[j] + x));
+            v = _mm256_add_epi16(v, _mm256_mulhrs_epi16(r, kv[j]));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(tmp + x), v);
+    };
+
+    for (; x + 16 <= n; x += 16) {
+        step(x);
+    }
+
+    // remainder: overlap with the last full vector instead of a scalar loop
+    if (x < n && n >= 16) {
+        step(n - 16);
+        x = n;
+    }
+#endif
+
+    for (; x < n; ++x) {
+        i16 v = 0;
+
+        for (index_t j = 0; j < Ny; ++j) {
+            v += mul(rows[j][x], k[j]);
+        }
+
+        tmp[x] = v;
+    }
+}
+
+/*
+ * Horizontal pass on a buffered row, extended by the kernel radius on both
+ * sides.
+ */
+template<index_t Nx>
+inline void pass_x(i16* out, i16 const* tmp, index_t n, Kernel<i16, Nx, 1> const& k)
+{
+    constexpr index_t d = (Nx - 1) / 2;
+
+    i16 const* const base = tmp - d;
+
+    index_t x = 0;
+
+#if defined(__AVX2__)
+    __m256i kv[Nx];
+    for (index_t i = 0; i < Nx; ++i) {
+        kv[i] = _mm256_set1_epi16(k[i]);
+    }
+
+    auto const step = [&](index_t x) {
+        auto v = _mm256_setzero_si256();
+
+        for (index_t i = 0; i < Nx; ++i) {
+            auto const r = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(base + x + i));
+            v = _mm256_add_epi16(v, _mm256_mulhrs_epi16(r, kv[i]));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+    };
+
+    for (; x + 16 <= n; x += 16) {
+        step(x);
+    }
+
+    // remainder: overlap with the last full vector, see above
+    if (x < n && n >= 16) {
+        step(n - 16);
+        x = n;
+    }
+#endif
+
+    for (; x < n; ++x) {
+        i16 v = 0;
+
+        for (index_t i = 0; i < Nx; ++i) {
+            v += mul(base[x + i], k[i]);
+        }
+
+        out[x] = v;
+    }
+}
+
+/*
+ * Sum of a row of n values.
+ */
+inline auto row_sum(i16 const* row, index_t n) -> i64
+{
+    index_t x = 0;
+    i64 sum = 0;
+
+#if defined(__AVX2__)
+    // adds less than 2^16 per i32 lane and step, so this cannot overflow for
+    // rows of less than 2^19 pixels
+    auto const ones = _mm256_set1_epi16(1);
+    auto acc = _mm256_setzero_si256();
+
+    for (; x + 16 <= n; x += 16) {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row + x));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(v, ones));
+    }
+
+    // half vector for the common case of widths divisible by 8
+    if (x + 8 <= n) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+        auto const m = _mm_madd_epi16(v, _mm256_castsi256_si128(ones));
+
+        acc = _mm256_add_epi32(acc, _mm256_zextsi128_si256(m));
+        x += 8;
+    }
+
+    alignas(32) i32 lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+
+    for (auto const l : lanes) {
+        sum += l;
+    }
+#endif
+
+    for (; x < n; ++x) {
+        sum += row[x];
+    }
+
+    return sum;
+}
+
+/*
+ * Replace each value s of the row by max(s - offs, 0), saturated to i16, and
+ * write it, times the given scale, to out.
+ */
+inline void row_sub_clamp_convert(f32* out, i16* row, index_t n, i16 offs, f32 scale)
+{
+    index_t x = 0;
+
+#if defined(__AVX2__)
+    auto const vo = _mm256_set1_epi16(offs);
+    auto const vs = _mm256_set1_ps(scale);
+    auto const vz = _mm256_setzero_si256();
+
+    for (; x + 16 <= n; x += 16) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row + x));
+        v = _mm256_max_epi16(_mm256_subs_epi16(v, vo), vz);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x), v);
+
+        auto const lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+        auto const hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+
+        _mm256_storeu_ps(out + x, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vs));
+        _mm256_storeu_ps(out + x + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vs));
+    }
+
+    // half vector, see row_sum()
+    if (x + 8 <= n) {
+        auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+        v = _mm_max_epi16(_mm_subs_epi16(v, _mm256_castsi256_si128(vo)), _mm_setzero_si128());
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), v);
+        _mm256_storeu_ps(out + x, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), vs));
+        x += 8;
+    }
+#endif
+
+    for (; x < n; ++x) {
+        row[x] = static_cast<i16>(std::clamp(row[x] - offs, 0, 32767));
+        out[x] = static_cast<f32>(row[x]) * scale;
+    }
+}
+
+} /* namespace impl */
+
+
+/*
+ * Convolve the raw samples with extend border, and apply row_op(row, n) to
+ * each output row right after it has been computed. The output may have a
+ * halo (see Layout), which is not written.
+ *
+ * Each input row is converted to fixed point only once, into a ring buffer
+ * holding the Ny rows covered by the kernel.
+ */
+template<index_t Nx, index_t Ny, typename F>
+void convolve(Image<i16>& out, Image<u8> const& in, u8 z_max, SeparableKernel<i16, Nx, Ny> const& k,
+              F row_op)
+{
+    constexpr index_t stack_len = 4096;
+    constexpr index_t dx = (Nx - 1) / 2;
+    constexpr index_t dy = (Ny - 1) / 2;
+
+    assert(out.size() == in.size());
+
+    auto const size = in.size();
+    auto const len = Ny * size.x + size.x + 2 * dx;
+
+    i16 buf_stack[stack_len];
+    auto buf_heap = std::vector<i16>{};
+
+    i16* buf = buf_stack;
+    if (len > stack_len) {
+        buf_heap.resize(len);
+        buf = buf_heap.data();
+    }
+
+    // rows of the ring buffer, input row r is stored at r % Ny
+    auto const ring = [&](index_t r) -> i16* {
+        return buf + (r % Ny) * size.x;
+    };
+
+    auto const convert = [&](index_t r) {
+        impl::convert_row(ring(r), in.data() + r * in.stride(), size.x, z_max);
+    };
+
+    i16* const tmp = buf + Ny * size.x + dx;
+
+    for (index_t r = 0; r < std::min(dy, size.y); ++r) {
+        convert(r);
+    }
+
+    for (index_t y = 0; y < size.y; ++y) {
+        i16* const row = out.data() + y * out.stride();
+
+        if (y + dy < size.y) {
+            convert(y + dy);
+        }
+
+        i16 const* rows[Ny];
+        for (index_t j = 0; j < Ny; ++j) {
+            rows[j] = ring(std::clamp(y + j - dy, 0, size.y - 1));
+        }
+
+        impl::pass_y(tmp, rows, size.x, k.y);
+        conv::impl::sep::extend_row<1>(tmp, size.x, dx);
+        impl::pass_x(row, tmp, size.x, k.x);
+
+        row_op(row, size.x);
+    }
+}
+
+/*
+ * Convolve the raw samples and return the sum of all output values,
+ * computed in the same sweep.
+ */
+template<index_t Nx, index_t Ny>
+auto convolve_sum(Image<i16>& out, Image<u8> const& in, u8 z_max,
+                  SeparableKernel<i16, Nx, Ny> const& k) -> i64
+{
+    i64 sum = 0;
+
+    convolve(out, in, z_max, k, [&](i16* row, index_t n) {
+        sum += impl::row_sum(row, n);
+    });
+
+    return sum;
+}
+
+/*
+ * Convolve the raw samples, and replace each output value s by
+ * max(s - offs, 0), writing the result converted to float, i.e. multiplied by
+ * scale, to out, all in the same sweep. Returns the sum of the output values
+ * before subtraction, see convolve_sum_subtract_clamp() for the float
+ * version.
+ */
+template<index_t Nx, index_t Ny>
+auto convolve_sum_subtract_clamp_convert(Image<f32>& out, Image<i16>& img, Image<u8> const& in,
+                                         u8 z_max, SeparableKernel<i16, Nx, Ny> const& k,
+                                         i16 offs, f32 scale) -> i64
+{
+    assert(out.size() == img.size());
+
+    i64 sum = 0;
+    index_t y = 0;
+
+    convolve(img, in, z_max, k, [&](i16* row, index_t n) {
+        sum += impl::row_sum(row, n);
+        impl::row_sub_clamp_convert(out.row(y++), row, n, offs, scale);
+    });
+
+    return sum;
+}
+
+/*
+ * Replace each value s by max(s - offs, 0), and write the result converted
+ * to float, i.e. multiplied by scale, to out.
+ */
+inline void subtract_clamp_convert(Image<f32>& out, Image<i16>& img, i16 offs, f32 scale)
+{
+    assert(out.size() == img.size());
+
+    for (index_t y = 0; y < img.size().y; ++y) {
+        impl::row_sub_clamp_convert(out.data() + y * out.stride(), img.data() + y * img.stride(),
+                                    img.size().x, offs, scale);
+    }
+}
+
+} /* namespace iptsd::alg::fixed */
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "types.hpp"
+#include "container/image.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg::roi {
+
+/*
+ * Inclusive pixel bounds of a region.
+ */
+struct BBox {
+    index_t xmin, xmax;
+    index_t ymin, ymax;
+};
+
+inline auto size(BBox const& b) -> index2_t
+{
+    return { b.xmax - b.xmin + 1, b.ymax - b.ymin + 1 };
+}
+
+inline auto intersects(BBox const& a, BBox const& b) -> bool
+{
+    return a.xmin <= b.xmax && b.xmin <= a.xmax && a.ymin <= b.ymax && b.ymin <= a.ymax;
+}
+
+inline auto merge(BBox const& a, BBox const& b) -> BBox
+{
+    return {
+        std::min(a.xmin, b.xmin), std::max(a.xmax, b.xmax),
+        std::min(a.ymin, b.ymin), std::max(a.ymax, b.ymax),
+    };
+}
+
+
+// width and height of the blocks in which active pixels are collected
+inline constexpr index_t block_size = 8;
+
+
+namespace impl {
+
+inline constexpr BBox empty = {
+    std::numeric_limits<index_t>::max(), std::numeric_limits<index_t>::min(),
+    std::numeric_limits<index_t>::max(), std::numeric_limits<index_t>::min(),
+};
+
+/*
+ * Find the first and last pixel above the threshold in row[0..n).
+ */
+template<typename T>
+inline auto row_bounds(T const* row, index_t n, T threshold, index_t& first, index_t& last) -> bool
+{
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f32>) {
+        if (n == block_size) {
+            auto const v = _mm256_cmp_ps(_mm256_loadu_ps(row), _mm256_set1_ps(threshold), _CMP_GT_OQ);
+            auto const m = static_cast<unsigned>(_mm256_movemask_ps(v));
+
+            if (m == 0)
+                return false;
+
+            first = __builtin_ctz(m);
+            last = 31 - __builtin_clz(m);
+            return true;
+        }
+    }
+#endif
+
+    first = -1;
+    for (index_t x = 0; x < n; ++x) {
+        if (row[x] > threshold) {
+            if (first < 0)
+                first = x;
+
+            last = x;
+        }
+    }
+
+    return first >= 0;
+}
+
+} /* namespace impl */
+
+
+/*
+ * Compute the regions of the image containing all pixels above the
+ * threshold, extended by the given margin and clamped to the image.
+ *
+ * Active pixels are first collected into tight bounding boxes per block of
+ * 8x8 pixels, which are then grown by the margin and merged until no two
+ * regions overlap. Thus, each active pixel lies at least margin pixels
+ * inside of its region (or at the image border), and any path of adjacent
+ * active pixels stays within one region. This allows running neighborhood
+ * operations with a support of up to margin pixels independently on each
+ * region, with the same result as for the full image, as long as pixels
+ * outside of all regions are known to be inactive.
+ */
+template<typename T>
+void find_regions(std::vector<BBox>& out, Image<T> const& img, T threshold, index_t margin)
+{
+    auto const size = img.size();
+    auto const nbx = (size.x + block_size - 1) / block_size;
+
+    out.clear();
+
+    // pass 1: bounding boxes of the active pixels per block
+    for (index_t by = 0; by * block_size < size.y; ++by) {
+        auto const base = out.size();
+
+        out.resize(base + nbx, impl::empty);
+
+        auto const y0 = by * block_size;
+        auto const y1 = std::min(y0 + block_size, size.y);
+
+        for (index_t y = y0; y < y1; ++y) {
+            T const* const row = img.data() + y * img.stride();
+
+            for (index_t bx = 0; bx < nbx; ++bx) {
+                auto const x0 = bx * block_size;
+                auto const n = std::min(block_size, size.x - x0);
+
+                index_t first, last;
+                if (!impl::row_bounds(row + x0, n, threshold, first, last))
+                    continue;
+
+                auto& b = out[base + bx];
+                b.xmin = std::min(b.xmin, x0 + first);
+                b.xmax = std::max(b.xmax, x0 + last);
+                b.ymin = std::min(b.ymin, y);
+                b.ymax = y;
+            }
+        }
+
+        // drop inactive blocks
+        auto const end = std::remove_if(out.begin() + base, out.end(), [](BBox const& b) {
+            return b.xmin > b.xmax;
+        });
+
+        out.erase(end, out.end());
+    }
+
+    // pass 2: add margin
+    for (auto& b : out) {
+        b.xmin = std::max(b.xmin - margin, 0);
+        b.xmax = std::min(b.xmax + margin, size.x - 1);
+        b.ymin = std::max(b.ymin - margin, 0);
+        b.ymax = std::min(b.ymax + margin, size.y - 1);
+    }
+
+    // pass 3: merge overlapping regions until all are disjoint
+    bool merged = true;
+    while (merged) {
+        merged = false;
+
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            for (std::size_t j = i + 1; j < out.size(); ++j) {
+                if (!intersects(out[i], out[j]))
+                    continue;
+
+                out[i] = merge(out[i], out[j]);
+                out[j] = out.back();
+                out.pop_back();
+
+                merged = true;
+                j = i;      // re-check the grown region against all others
+            }
+        }
+    }
+}
+
+} /* namespace iptsd::alg::roi */
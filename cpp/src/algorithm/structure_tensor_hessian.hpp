@@ -0,0 +1,278 @@
+#pragma once
+
+#include "types.hpp"
+
+#include "algorithm/convolution.hpp"
+
+#include "container/image.hpp"
+#include "container/kernel.hpp"
+#include "container/tensor_image.hpp"
+
+#include "math/num.hpp"
+#include "math/mat2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::alg {
+namespace sthess::impl {
+
+/*
+ * The Sobel kernels used by structure_tensor() and hessian() are separable,
+ * so all five derivatives can be expressed via three vertical filters of the
+ * columns of each neighborhood:
+ *
+ *   s = [1, 2, 1]^T, t = [1, 0, -1]^T, u = [1, -2, 1]^T
+ *
+ * With s, t, u of the left (l), center (c), and right (r) column, we get
+ *
+ *   gx  = s_l - s_r             hxx = s_l - 2 s_c + s_r
+ *   gy  = t_l + 2 t_c + t_r     hyy = u_l + 2 u_c + u_r
+ *                               hxy = t_l - t_r
+ *
+ * These column filters are computed once per column and shifted along the
+ * row, i.e. each input pixel is read three times instead of 27 times.
+ *
+ * Calls write(i, st, hs) for each pixel index i, with zero border.
+ */
+template<typename T, typename F>
+void structure_tensor_hessian_3x3_zero(Image<T> const& in, F write)
+{
+    struct column {
+        T s, t, u;
+    };
+
+    auto const size = in.size();
+    auto const stride = in.stride();
+
+    auto const zero = column { math::num<T>::zero, math::num<T>::zero, math::num<T>::zero };
+
+    for (index_t y = 0; y < size.y; ++y) {
+        // rows outside of the image are zero, mask them instead of branching
+        T const* const r0 = &in[std::max(y - 1, 0) * stride];
+        T const* const r1 = &in[y * stride];
+        T const* const r2 = &in[std::min(y + 1, size.y - 1) * stride];
+
+        T const w0 = y > 0 ? math::num<T>::one : math::num<T>::zero;
+        T const w2 = y < size.y - 1 ? math::num<T>::one : math::num<T>::zero;
+
+        auto const col = [&](index_t x) -> column {
+            T const a = r0[x] * w0;
+            T const b = r1[x];
+            T const c = r2[x] * w2;
+
+            return { (a + c) + 2 * b, a - c, (a + c) - 2 * b };
+        };
+
+        auto cl = zero;
+        auto cc = col(0);
+
+        for (index_t x = 0; x < size.x; ++x) {
+            auto const cr = x + 1 < size.x ? col(x + 1) : zero;
+
+            T const gx = cl.s - cr.s;
+            T const gy = cl.t + 2 * cc.t + cr.t;
+
+            auto const st = Mat2s<T> { gx * gx, gx * gy, gy * gy };
+            auto const hs = Mat2s<T> {
+                (cl.s + cr.s) - 2 * cc.s,
+                cl.t - cr.t,
+                (cl.u + cr.u) + 2 * cc.u,
+            };
+
+            write(y * stride + x, st, hs);
+
+            cl = cc;
+            cc = cr;
+        }
+    }
+}
+
+/*
+ * Same as above, writing to planar tensor images. Any of st and hs may be
+ * null, in which case that output is skipped. The interior of each row is
+ * vectorized, with the column filters computed directly from three shifted
+ * loads per row.
+ */
+template<typename T>
+void structure_tensor_hessian_planar(TensorImage<T>* st, TensorImage<T>* hs, Image<T> const& in)
+{
+    struct column {
+        T s, t, u;
+    };
+
+    auto const size = in.size();
+    auto const stride = in.stride();
+
+    auto const zero = column { math::num<T>::zero, math::num<T>::zero, math::num<T>::zero };
+
+    auto const store = [&](index_t i, T gx, T gy, column const& cl, column const& cc, column const& cr) {
+        if (st) {
+            st->xx()[i] = gx * gx;
+            st->xy()[i] = gx * gy;
+            st->yy()[i] = gy * gy;
+        }
+
+        if (hs) {
+            hs->xx()[i] = (cl.s + cr.s) - 2 * cc.s;
+            hs->xy()[i] = cl.t - cr.t;
+            hs->yy()[i] = (cl.u + cr.u) + 2 * cc.u;
+        }
+    };
+
+    for (index_t y = 0; y < size.y; ++y) {
+        T const* const r0 = &in[std::max(y - 1, 0) * stride];
+        T const* const r1 = &in[y * stride];
+        T const* const r2 = &in[std::min(y + 1, size.y - 1) * stride];
+
+        T const w0 = y > 0 ? math::num<T>::one : math::num<T>::zero;
+        T const w2 = y < size.y - 1 ? math::num<T>::one : math::num<T>::zero;
+
+        auto const col = [&](index_t x) -> column {
+            if (x < 0 || x >= size.x)
+                return zero;
+
+            T const a = r0[x] * w0;
+            T const b = r1[x];
+            T const c = r2[x] * w2;
+
+            return { (a + c) + 2 * b, a - c, (a + c) - 2 * b };
+        };
+
+        auto const pixel = [&](index_t x) {
+            auto const cl = col(x - 1);
+            auto const cc = col(x);
+            auto const cr = col(x + 1);
+
+            store(y * stride + x, cl.s - cr.s, cl.t + 2 * cc.t + cr.t, cl, cc, cr);
+        };
+
+        pixel(0);
+
+        index_t x = 1;
+
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<T, f32>) {
+            auto const vw0 = _mm256_set1_ps(w0);
+            auto const vw2 = _mm256_set1_ps(w2);
+            auto const two = _mm256_set1_ps(2.0f);
+
+            struct vcolumn {
+                __m256 s, t, u;
+            };
+
+            auto const vcol = [&](index_t xv) -> vcolumn {
+                auto const a = _mm256_mul_ps(_mm256_loadu_ps(r0 + xv), vw0);
+                auto const b = _mm256_loadu_ps(r1 + xv);
+                auto const c = _mm256_mul_ps(_mm256_loadu_ps(r2 + xv), vw2);
+
+                auto const ac = _mm256_add_ps(a, c);
+                auto const b2 = _mm256_mul_ps(two, b);
+
+                return { _mm256_add_ps(ac, b2), _mm256_sub_ps(a, c), _mm256_sub_ps(ac, b2) };
+            };
+
+            for (; x + 8 <= size.x - 1; x += 8) {
+                auto const cl = vcol(x - 1);
+                auto const cc = vcol(x);
+                auto const cr = vcol(x + 1);
+
+                auto const i = y * stride + x;
+
+                if (st) {
+                    auto const gx = _mm256_sub_ps(cl.s, cr.s);
+                    auto const gy = _mm256_add_ps(_mm256_add_ps(cl.t, _mm256_mul_ps(two, cc.t)), cr.t);
+
+                    _mm256_storeu_ps(st->xx() + i, _mm256_mul_ps(gx, gx));
+                    _mm256_storeu_ps(st->xy() + i, _mm256_mul_ps(gx, gy));
+                    _mm256_storeu_ps(st->yy() + i, _mm256_mul_ps(gy, gy));
+                }
+
+                if (hs) {
+                    auto const hxx = _mm256_sub_ps(_mm256_add_ps(cl.s, cr.s), _mm256_mul_ps(two, cc.s));
+                    auto const hxy = _mm256_sub_ps(cl.t, cr.t);
+                    auto const hyy = _mm256_add_ps(_mm256_add_ps(cl.u, cr.u), _mm256_mul_ps(two, cc.u));
+
+                    _mm256_storeu_ps(hs->xx() + i, hxx);
+                    _mm256_storeu_ps(hs->xy() + i, hxy);
+                    _mm256_storeu_ps(hs->yy() + i, hyy);
+                }
+            }
+        }
+#endif
+
+        for (; x < size.x; ++x) {
+            pixel(x);
+        }
+    }
+}
+
+} /* namespace sthess::impl */
+
+
+/*
+ * Computes structure_tensor() and hessian() with their default Sobel kernels
+ * and zero border in a single pass, reading each neighborhood only once.
+ */
+template<typename T>
+void structure_tensor_hessian(Image<Mat2s<T>>& st, Image<Mat2s<T>>& hs, Image<T> const& in)
+{
+    assert(st.size() == in.size());
+    assert(hs.size() == in.size());
+
+    sthess::impl::structure_tensor_hessian_3x3_zero(in, [&](index_t i, auto const& s, auto const& h) {
+        st[i] = s;
+        hs[i] = h;
+    });
+}
+
+/*
+ * As above, but writes both tensors interleaved into a single image, i.e. as
+ * six channels per pixel. This allows smoothing both with one convolution.
+ */
+template<typename T>
+void structure_tensor_hessian(Image<std::array<Mat2s<T>, 2>>& out, Image<T> const& in)
+{
+    assert(out.size() == in.size());
+
+    sthess::impl::structure_tensor_hessian_3x3_zero(in, [&](index_t i, auto const& s, auto const& h) {
+        out[i] = { s, h };
+    });
+}
+
+/*
+ * Planar versions of structure_tensor(), hessian(), and
+ * structure_tensor_hessian() with default Sobel kernels and zero border.
+ */
+template<typename T>
+void structure_tensor(TensorImage<T>& out, Image<T> const& in)
+{
+    assert(out.size() == in.size());
+
+    sthess::impl::structure_tensor_hessian_planar<T>(&out, nullptr, in);
+}
+
+template<typename T>
+void hessian(TensorImage<T>& out, Image<T> const& in)
+{
+    assert(out.size() == in.size());
+
+    sthess::impl::structure_tensor_hessian_planar<T>(nullptr, &out, in);
+}
+
+template<typename T>
+void structure_tensor_hessian(TensorImage<T>& st, TensorImage<T>& hs, Image<T> const& in)
+{
+    assert(st.size() == in.size());
+    assert(hs.size() == in.size());
+
+    sthess::impl::structure_tensor_hessian_planar<T>(&st, &hs, in);
+}
+
+} /* namespace iptsd::alg */
@@ -4,12 +4,65 @@
 #include "utils/access.hpp"
 
 #include <algorithm>
+#include <cassert>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 
 namespace iptsd::container {
 
+namespace impl {
+
+/*
+ * All image storage is aligned to (at least) a cache line.
+ */
+inline constexpr std::size_t storage_alignment = 64;
+
+template<class T>
+struct aligned_deleter {
+    void operator() (T* p) const
+    {
+        ::operator delete[](p, std::align_val_t { storage_alignment });
+    }
+};
+
+template<class T>
+using aligned_ptr = std::unique_ptr<T[], aligned_deleter<T>>;
+
+template<class T>
+auto aligned_alloc(std::size_t n) -> aligned_ptr<T>
+{
+    static_assert(std::is_trivially_destructible_v<T>);
+
+    auto* const p = static_cast<T*>(::operator new[](n * sizeof(T), std::align_val_t { storage_alignment }));
+    std::uninitialized_default_construct_n(p, n);
+
+    return aligned_ptr<T> { p };
+}
+
+} /* namespace impl */
+
+
+/**
+ * Layout - Memory layout policy of an image.
+ * @halo:       Number of additional pixels on each side of the image.
+ * @align_rows: Pad rows such that each one starts at a 64 byte boundary.
+ *
+ * The default layout is dense, i.e. stride() == size().x. With a halo or
+ * aligned rows, pixel (x, y) is located at data()[y * stride() + x], and the
+ * halo can be accessed via negative or out-of-range coordinates up to the
+ * halo width. Kernels can fill the halo once (see Image::fill_halo()) and
+ * then process the full image without special-casing its border.
+ */
+struct Layout {
+    index_t halo = 0;
+    bool align_rows = false;
+};
+
+
 template<class T>
 class Image {
 public:
@@ -25,7 +78,7 @@ public:
 
 public:
     Image();
-    Image(index2_t size);
+    Image(index2_t size, Layout layout={});
     Image(Image const& other);
     Image(Image&& other) noexcept;
 
@@ -34,10 +87,16 @@ public:
 
     auto size() const -> index2_t;
     auto stride() const -> index_t;
+    auto halo() const -> index_t;
+    auto layout() const -> Layout;
+    auto offset() const -> index_t;
 
     auto data() -> pointer;
     auto data() const -> const_pointer;
 
+    auto row(index_t y) -> pointer;
+    auto row(index_t y) const -> const_pointer;
+
     auto operator[] (index2_t const& i) const -> const_reference;
     auto operator[] (index2_t const& i) -> reference;
 
@@ -53,59 +112,106 @@ public:
     auto cbegin() const -> const_iterator;
     auto cend() const -> const_iterator;
 
+    void fill_halo(T const& value);
+
+    void reserve(index2_t size);
+    void resize(index2_t size);
+    auto capacity() const -> index_t;
+
+    auto ravel(index2_t i) const -> index_t;
+
     static constexpr auto ravel(index2_t size, index2_t i) -> index_t;
     static constexpr auto unravel(index2_t size, index_t i) -> index2_t;
 
 private:
-    index2_t             m_size;
-    std::unique_ptr<T[]> m_data;
+    struct Geometry {
+        index_t stride;
+        index_t offset;
+        index_t len;
+    };
+
+    static auto geometry(index2_t size, Layout layout) -> Geometry;
+
+    void allocate(index2_t size, Layout layout);
+
+private:
+    index2_t                 m_size;
+    index_t                  m_stride;
+    Layout                   m_layout;
+    index_t                  m_offset;
+    index_t                  m_len;
+    index_t                  m_capacity;
+    impl::aligned_ptr<T>     m_data;
 };
 
 
 template<class T>
 Image<T>::Image()
     : m_size{0, 0}
+    , m_stride{0}
+    , m_layout{}
+    , m_offset{0}
+    , m_len{0}
+    , m_capacity{0}
     , m_data{nullptr}
 {}
 
 template<class T>
-Image<T>::Image(index2_t size)
+Image<T>::Image(index2_t size, Layout layout)
     : m_size{0, 0}
+    , m_stride{0}
+    , m_layout{}
+    , m_offset{0}
+    , m_len{0}
+    , m_capacity{0}
     , m_data{nullptr}
 {
-    m_data = std::unique_ptr<T[]> { new T[size.span()] };
-    m_size = size;
+    this->allocate(size, layout);
 }
 
 template<class T>
 Image<T>::Image(Image const& other)
     : m_size{0, 0}
+    , m_stride{0}
+    , m_layout{}
+    , m_offset{0}
+    , m_len{0}
+    , m_capacity{0}
     , m_data{nullptr}
 {
     // implement in terms of copy assignment operator to not leak any memory if copy throws...
     auto tmp = Image<T>{};
     tmp = other;
 
-    std::swap(m_size, tmp.m_size);
-    std::swap(m_data, tmp.m_data);
+    *this = std::move(tmp);
 }
 
 template<class T>
 Image<T>::Image(Image&& other) noexcept
     : m_size{std::exchange(other.m_size, { 0, 0 })}
+    , m_stride{std::exchange(other.m_stride, 0)}
+    , m_layout{std::exchange(other.m_layout, {})}
+    , m_offset{std::exchange(other.m_offset, 0)}
+    , m_len{std::exchange(other.m_len, 0)}
+    , m_capacity{std::exchange(other.m_capacity, 0)}
     , m_data{std::exchange(other.m_data, nullptr)}
 {}
 
 template<class T>
 auto Image<T>::operator= (Image<T> const& rhs) -> Image<T>&
 {
-    if (m_size != rhs.m_size) {
+    if (this == &rhs)
+        return *this;
+
+    if (m_size != rhs.m_size || m_stride != rhs.m_stride || m_offset != rhs.m_offset) {
         m_data = nullptr;   // free old data first and set to nullptr
-        m_data = std::unique_ptr<T[]> { new T[rhs.m_size.span()] };
-        m_size = rhs.m_size;
+        this->allocate(rhs.m_size, rhs.m_layout);
     }
 
-    std::copy(rhs.begin(), rhs.end(), this->begin());
+    m_layout = rhs.m_layout;
+
+    // copy everything, including halo
+    std::copy(rhs.m_data.get(), rhs.m_data.get() + rhs.m_len, m_data.get());
 
     return *this;
 }
@@ -115,10 +221,95 @@ auto Image<T>::operator= (Image<T>&& rhs) noexcept -> Image<T>&
 {
     m_data = std::exchange(rhs.m_data, nullptr);
     m_size = std::exchange(rhs.m_size, {0, 0});
+    m_stride = std::exchange(rhs.m_stride, 0);
+    m_layout = std::exchange(rhs.m_layout, {});
+    m_offset = std::exchange(rhs.m_offset, 0);
+    m_len = std::exchange(rhs.m_len, 0);
+    m_capacity = std::exchange(rhs.m_capacity, 0);
 
     return *this;
 }
 
+template<class T>
+auto Image<T>::geometry(index2_t size, Layout layout) -> Geometry
+{
+    auto const h = layout.halo;
+
+    index_t lead = h;
+    index_t stride = size.x + 2 * h;
+
+    if (layout.align_rows && impl::storage_alignment % sizeof(T) == 0) {
+        constexpr auto n = static_cast<index_t>(impl::storage_alignment / sizeof(T));
+
+        // align the first pixel of each row, not the first halo pixel
+        lead = (h + n - 1) / n * n;
+        stride = (lead + size.x + h + n - 1) / n * n;
+    }
+
+    return { stride, h * stride + lead, (size.y + 2 * h) * stride };
+}
+
+template<class T>
+void Image<T>::allocate(index2_t size, Layout layout)
+{
+    auto const g = geometry(size, layout);
+
+    m_data = impl::aligned_alloc<T>(g.len);
+    m_size = size;
+    m_stride = g.stride;
+    m_layout = layout;
+    m_offset = g.offset;
+    m_len = g.len;
+    m_capacity = g.len;
+}
+
+/*
+ * Make sure that the image can be resized to the given size (or any smaller
+ * one) without reallocating. The size itself does not change, but the
+ * contents are undefined if the storage has to grow.
+ */
+template<class T>
+void Image<T>::reserve(index2_t size)
+{
+    auto const g = geometry(size, m_layout);
+
+    if (g.len > m_capacity) {
+        auto const current = m_size;
+
+        m_data = nullptr;
+        this->allocate(size, m_layout);
+        this->resize(current);
+    }
+}
+
+/*
+ * Change the size, keeping the layout. Only reallocates if the storage is too
+ * small, i.e. the capacity never shrinks. The contents, including the halo,
+ * are undefined afterwards.
+ */
+template<class T>
+void Image<T>::resize(index2_t size)
+{
+    auto const g = geometry(size, m_layout);
+
+    if (g.len > m_capacity) {
+        m_data = nullptr;
+        this->allocate(size, m_layout);
+        return;
+    }
+
+    m_size = size;
+    m_stride = g.stride;
+    m_offset = g.offset;
+    m_len = g.len;
+}
+
+template<class T>
+inline auto Image<T>::capacity() const -> index_t
+{
+    return m_capacity;
+}
+
 
 template<class T>
 inline auto Image<T>::size() const -> index2_t
@@ -129,82 +320,179 @@ inline auto Image<T>::size() const -> index2_t
 template<class T>
 inline auto Image<T>::stride() const -> index_t
 {
-    return m_size.x;
+    return m_stride;
+}
+
+template<class T>
+inline auto Image<T>::halo() const -> index_t
+{
+    return m_layout.halo;
+}
+
+template<class T>
+inline auto Image<T>::layout() const -> Layout
+{
+    return m_layout;
+}
+
+/*
+ * Offset of the first pixel from the start of the allocation, i.e.
+ * data() - offset() points to the first halo element.
+ */
+template<class T>
+inline auto Image<T>::offset() const -> index_t
+{
+    return m_offset;
 }
 
 template<class T>
 inline auto Image<T>::data() -> pointer
 {
-    return m_data.get();
+    return m_data.get() + m_offset;
 }
 
 template<class T>
 inline auto Image<T>::data() const -> const_pointer
 {
-    return m_data.get();
+    return m_data.get() + m_offset;
+}
+
+/*
+ * Pointer to the first pixel of row y, followed by the remaining size().x - 1
+ * pixels of that row.
+ */
+template<class T>
+inline auto Image<T>::row(index_t y) -> pointer
+{
+    utils::access::ensure(m_size.y, y);
+
+    return this->data() + y * m_stride;
+}
+
+template<class T>
+inline auto Image<T>::row(index_t y) const -> const_pointer
+{
+    utils::access::ensure(m_size.y, y);
+
+    return this->data() + y * m_stride;
 }
 
 template<class T>
 inline auto Image<T>::operator[] (index2_t const& i) const -> const_reference
 {
-    return utils::access::access<T>(m_data, ravel, m_size, i);
+    auto const h = m_layout.halo;
+
+    utils::access::ensure({ m_size.x + 2 * h, m_size.y + 2 * h }, { i.x + h, i.y + h });
+
+    return this->data()[this->ravel(i)];
 }
 
 template<class T>
 inline auto Image<T>::operator[] (index2_t const& i) -> reference
 {
-    return utils::access::access<T>(m_data, ravel, m_size, i);
+    auto const h = m_layout.halo;
+
+    utils::access::ensure({ m_size.x + 2 * h, m_size.y + 2 * h }, { i.x + h, i.y + h });
+
+    return this->data()[this->ravel(i)];
 }
 
+/*
+ * Flat indices are row-major over size(), as returned by the static ravel(),
+ * and are thus only available for dense images. Use 2D indices or row() for
+ * images with padded rows or a halo.
+ */
 template<class T>
 inline auto Image<T>::operator[] (index_t const& i) const -> const_reference
 {
-    return utils::access::access<T>(m_data, m_size.span(), i);
+    assert(m_stride == m_size.x);
+    utils::access::ensure(m_len, i + m_offset);
+
+    return this->data()[i];
 }
 
 template<class T>
 inline auto Image<T>::operator[] (index_t const& i) -> reference
 {
-    return utils::access::access<T>(m_data, m_size.span(), i);
+    assert(m_stride == m_size.x);
+    utils::access::ensure(m_len, i + m_offset);
+
+    return this->data()[i];
 }
 
+/*
+ * Iterators span all pixels in row-major order, and are thus only available
+ * for dense images. Use row() to iterate over images with padded rows or a
+ * halo.
+ */
 template<class T>
 inline auto Image<T>::begin() -> iterator
 {
-    return &m_data[0];
+    assert(m_stride == m_size.x);
+
+    return this->data();
 }
 
 template<class T>
 inline auto Image<T>::end() -> iterator
 {
-    return &m_data[m_size.span()];
+    assert(m_stride == m_size.x);
+
+    return this->data() + m_size.span();
 }
 
 template<class T>
 inline auto Image<T>::begin() const -> const_iterator
 {
-    return &m_data[0];
+    assert(m_stride == m_size.x);
+
+    return this->data();
 }
 
 template<class T>
 inline auto Image<T>::end() const -> const_iterator
 {
-    return &m_data[m_size.span()];
+    assert(m_stride == m_size.x);
+
+    return this->data() + m_size.span();
 }
 
 template<class T>
 inline auto Image<T>::cbegin() const -> const_iterator
 {
-    return &m_data[0];
+    return this->begin();
 }
 
 template<class T>
 inline auto Image<T>::cend() const -> const_iterator
 {
-    return &m_data[m_size.span()];
+    return this->end();
 }
 
 
+template<class T>
+void Image<T>::fill_halo(T const& value)
+{
+    auto const h = m_layout.halo;
+
+    for (index_t y = -h; y < m_size.y + h; ++y) {
+        for (index_t x = -h; x < m_size.x + h; ++x) {
+            if (y >= 0 && y < m_size.y && x >= 0 && x < m_size.x)
+                x = m_size.x;       // skip to right halo
+
+            if (x < m_size.x + h)
+                this->data()[this->ravel({ x, y })] = value;
+        }
+    }
+}
+
+
+template<class T>
+inline auto Image<T>::ravel(index2_t i) const -> index_t
+{
+    return i.y * m_stride + i.x;
+}
+
 template<class T>
 inline constexpr auto Image<T>::ravel(index2_t size, index2_t i) -> index_t
 {
@@ -224,5 +512,6 @@ inline constexpr auto Image<T>::unravel(index2_t size, index_t i) -> index2_t
 namespace iptsd {
 
 using container::Image;
+using container::Layout;
 
 } /* namespace iptsd */
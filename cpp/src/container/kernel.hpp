@@ -190,6 +190,58 @@ inline constexpr auto Kernel<T, Nx, Ny>::unravel(index2_t size, index_t i) -> in
     return { i % size.x, i / size.x };
 }
 
+
+/**
+ * SeparableKernel - Kernel given as outer product of a row and column vector.
+ * @x: Row vector, applied along the x-axis.
+ * @y: Column vector, applied along the y-axis.
+ *
+ * Represents the kernel K[x, y] = y[y] * x[x], which allows applying it in
+ * two one-dimensional passes, i.e. with Nx + Ny instead of Nx * Ny
+ * multiplications per pixel.
+ */
+template<class T, index_t Nx, index_t Ny>
+struct SeparableKernel {
+public:
+    Kernel<T, Nx, 1> x;
+    Kernel<T, 1, Ny> y;
+
+public:
+    using value_type = T;
+
+public:
+    auto size() const -> index2_t;
+
+    auto outer() const -> Kernel<T, Nx, Ny>;
+};
+
+template<class T, index_t Nx, index_t Ny>
+auto SeparableKernel<T, Nx, Ny>::size() const -> index2_t
+{
+    return { Nx, Ny };
+}
+
+template<class T, index_t Nx, index_t Ny>
+auto SeparableKernel<T, Nx, Ny>::outer() const -> Kernel<T, Nx, Ny>
+{
+    auto k = Kernel<T, Nx, Ny>{};
+
+    for (index_t iy = 0; iy < Ny; ++iy) {
+        for (index_t ix = 0; ix < Nx; ++ix) {
+            k[{ix, iy}] = this->y[iy] * this->x[ix];
+        }
+    }
+
+    return k;
+}
+
+
+template<class T, index_t Nx, index_t Ny>
+auto operator<< (std::ostream& os, SeparableKernel<T, Nx, Ny> const& k) -> std::ostream&
+{
+    return os << k.outer();
+}
+
 } /* namespace iptsd::container */
 
 
@@ -197,5 +249,6 @@ inline constexpr auto Kernel<T, Nx, Ny>::unravel(index2_t size, index_t i) -> in
 namespace iptsd {
 
 using container::Kernel;
+using container::SeparableKernel;
 
 } /* namespace iptsd */
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "types.hpp"
+#include "utils/access.hpp"
+
+#include "container/image.hpp"
+
+#include "math/mat2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <utility>
+
+
+namespace iptsd::container {
+
+/**
+ * TensorImage - Image of symmetric 2x2 tensors in planar layout.
+ *
+ * Stores the xx, xy, and yy components of an Image<Mat2s<T>> in three
+ * separate planes, so that SIMD kernels can load each component directly
+ * without having to de-interleave it. Each plane starts on a 64 byte
+ * boundary. Pixels are addressed as in Image, i.e. via size(), stride(), and
+ * ravel()/unravel(), but elements are returned by value. Use set() or the
+ * plane pointers for writing.
+ */
+template<class T>
+class TensorImage {
+public:
+    static_assert(std::is_arithmetic_v<T>);
+
+    static constexpr std::size_t alignment = impl::storage_alignment;
+
+    using value_type    = Mat2s<T>;
+    using scalar_type   = T;
+    using pointer       = T*;
+    using const_pointer = T const*;
+
+public:
+    TensorImage();
+    TensorImage(index2_t size);
+    TensorImage(TensorImage const& other);
+    TensorImage(TensorImage&& other) noexcept;
+
+    auto operator= (TensorImage<T> const& rhs) -> TensorImage<T>&;
+    auto operator= (TensorImage<T>&& rhs) noexcept -> TensorImage<T>&;
+
+    auto size() const -> index2_t;
+    auto stride() const -> index_t;
+
+    void reserve(index2_t size);
+    void resize(index2_t size);
+
+    auto plane(index_t c) -> pointer;
+    auto plane(index_t c) const -> const_pointer;
+
+    auto xx() -> pointer;
+    auto xy() -> pointer;
+    auto yy() -> pointer;
+
+    auto xx() const -> const_pointer;
+    auto xy() const -> const_pointer;
+    auto yy() const -> const_pointer;
+
+    auto operator[] (index2_t const& i) const -> value_type;
+    auto operator[] (index_t const& i) const -> value_type;
+
+    void set(index2_t const& i, value_type const& v);
+    void set(index_t const& i, value_type const& v);
+
+    static constexpr auto ravel(index2_t size, index2_t i) -> index_t;
+    static constexpr auto unravel(index2_t size, index_t i) -> index2_t;
+
+private:
+    static auto plane_stride(index2_t size) -> index_t;
+    static auto allocate(index2_t size) -> impl::aligned_ptr<T>;
+
+private:
+    index2_t             m_size;
+    index_t              m_plane;
+    impl::aligned_ptr<T> m_data;
+};
+
+
+template<class T>
+inline auto TensorImage<T>::plane_stride(index2_t size) -> index_t
+{
+    // round each plane up to a multiple of the alignment
+    constexpr auto n = static_cast<index_t>(alignment / sizeof(T));
+
+    return (size.span() + n - 1) / n * n;
+}
+
+template<class T>
+inline auto TensorImage<T>::allocate(index2_t size) -> impl::aligned_ptr<T>
+{
+    return impl::aligned_alloc<T>(static_cast<std::size_t>(3 * plane_stride(size)));
+}
+
+
+template<class T>
+TensorImage<T>::TensorImage()
+    : m_size{0, 0}
+    , m_plane{0}
+    , m_data{nullptr}
+{}
+
+template<class T>
+TensorImage<T>::TensorImage(index2_t size)
+    : m_size{0, 0}
+    , m_plane{0}
+    , m_data{nullptr}
+{
+    m_data = allocate(size);
+    m_plane = plane_stride(size);
+    m_size = size;
+}
+
+template<class T>
+TensorImage<T>::TensorImage(TensorImage const& other)
+    : m_size{0, 0}
+    , m_plane{0}
+    , m_data{nullptr}
+{
+    *this = other;
+}
+
+template<class T>
+TensorImage<T>::TensorImage(TensorImage&& other) noexcept
+    : m_size{std::exchange(other.m_size, { 0, 0 })}
+    , m_plane{std::exchange(other.m_plane, 0)}
+    , m_data{std::exchange(other.m_data, nullptr)}
+{}
+
+template<class T>
+auto TensorImage<T>::operator= (TensorImage<T> const& rhs) -> TensorImage<T>&
+{
+    if (this == &rhs)
+        return *this;
+
+    if (m_size != rhs.m_size) {
+        m_data = nullptr;   // free old data first and set to nullptr
+        m_data = allocate(rhs.m_size);
+        m_plane = plane_stride(rhs.m_size);
+        m_size = rhs.m_size;
+    }
+
+    for (index_t c = 0; c < 3; ++c) {
+        std::copy(rhs.plane(c), rhs.plane(c) + m_size.span(), this->plane(c));
+    }
+
+    return *this;
+}
+
+template<class T>
+auto TensorImage<T>::operator= (TensorImage<T>&& rhs) noexcept -> TensorImage<T>&
+{
+    m_data = std::exchange(rhs.m_data, nullptr);
+    m_plane = std::exchange(rhs.m_plane, 0);
+    m_size = std::exchange(rhs.m_size, {0, 0});
+
+    return *this;
+}
+
+
+template<class T>
+inline auto TensorImage<T>::size() const -> index2_t
+{
+    return m_size;
+}
+
+template<class T>
+inline auto TensorImage<T>::stride() const -> index_t
+{
+    return m_size.x;
+}
+
+/*
+ * Make sure that the image can be resized to the given size (or any smaller
+ * one) without reallocating, see Image::reserve().
+ */
+template<class T>
+void TensorImage<T>::reserve(index2_t size)
+{
+    if (plane_stride(size) > m_plane) {
+        m_data = nullptr;
+        m_data = allocate(size);
+        m_plane = plane_stride(size);
+    }
+}
+
+/*
+ * Change the size, only reallocating if the planes are too small, see
+ * Image::resize(). The contents are undefined afterwards.
+ */
+template<class T>
+void TensorImage<T>::resize(index2_t size)
+{
+    this->reserve(size);
+    m_size = size;
+}
+
+template<class T>
+inline auto TensorImage<T>::plane(index_t c) -> pointer
+{
+    utils::access::ensure(3, c);
+
+    return m_data.get() + c * m_plane;
+}
+
+template<class T>
+inline auto TensorImage<T>::plane(index_t c) const -> const_pointer
+{
+    utils::access::ensure(3, c);
+
+    return m_data.get() + c * m_plane;
+}
+
+template<class T>
+inline auto TensorImage<T>::xx() -> pointer
+{
+    return this->plane(0);
+}
+
+template<class T>
+inline auto TensorImage<T>::xy() -> pointer
+{
+    return this->plane(1);
+}
+
+template<class T>
+inline auto TensorImage<T>::yy() -> pointer
+{
+    return this->plane(2);
+}
+
+template<class T>
+inline auto TensorImage<T>::xx() const -> const_pointer
+{
+    return this->plane(0);
+}
+
+template<class T>
+inline auto TensorImage<T>::xy() const -> const_pointer
+{
+    return this->plane(1);
+}
+
+template<class T>
+inline auto TensorImage<T>::yy() const -> const_pointer
+{
+    return this->plane(2);
+}
+
+template<class T>
+inline auto TensorImage<T>::operator[] (index2_t const& i) const -> value_type
+{
+    utils::access::ensure(m_size, i);
+
+    return (*this)[ravel(m_size, i)];
+}
+
+template<class T>
+inline auto TensorImage<T>::operator[] (index_t const& i) const -> value_type
+{
+    utils::access::ensure(m_size.span(), i);
+
+    auto const* p = m_data.get() + i;
+    return { p[0], p[m_plane], p[2 * m_plane] };
+}
+
+template<class T>
+inline void TensorImage<T>::set(index2_t const& i, value_type const& v)
+{
+    utils::access::ensure(m_size, i);
+
+    this->set(ravel(m_size, i), v);
+}
+
+template<class T>
+inline void TensorImage<T>::set(index_t const& i, value_type const& v)
+{
+    utils::access::ensure(m_size.span(), i);
+
+    auto* p = m_data.get() + i;
+    p[0]           = v.xx;
+    p[m_plane]     = v.xy;
+    p[2 * m_plane] = v.yy;
+}
+
+
+template<class T>
+inline constexpr auto TensorImage<T>::ravel(index2_t size, index2_t i) -> index_t
+{
+    return i.y * size.x + i.x;
+}
+
+template<class T>
+inline constexpr auto TensorImage<T>::unravel(index2_t size, index_t i) -> index2_t
+{
+    return { i % size.x, i / size.x };
+}
+
+} /* namespace iptsd::container */
+
+
+/* imports */
+namespace iptsd {
+
+using container::TensorImage;
+
+} /* namespace iptsd */
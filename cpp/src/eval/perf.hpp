@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include <string>
 #include <vector>
 #include <cmath>
@@ -28,6 +30,23 @@ private:
 };
 
 
+class CounterToken {
+private:
+    friend class Registry;
+
+public:
+    inline constexpr CounterToken(CounterToken const& other) = default;
+
+    inline constexpr auto operator= (CounterToken const& rhs) -> CounterToken& = default;
+
+private:
+    inline constexpr CounterToken(std::size_t index_t);
+
+private:
+    std::size_t m_index;
+};
+
+
 class Entry {
 public:
     Entry(std::string name);
@@ -63,6 +82,31 @@ public:
 };
 
 
+/*
+ * Statistics over arbitrary per-frame values, e.g. ratios or iteration
+ * counts, recorded alongside the timings.
+ */
+class Counter {
+public:
+    Counter(std::string name);
+
+    auto mean() const -> double;
+    auto var() const -> double;
+    auto stddev() const -> double;
+
+public:
+    std::string name;
+
+    unsigned int n_samples;
+    double sum;
+    double minimum;
+    double maximum;
+
+    double r_mean;
+    double r_var;
+};
+
+
 class measurement {
 public:
     ~measurement();
@@ -88,8 +132,16 @@ public:
 
     auto entries() const -> std::vector<Entry> const&;
 
+    auto create_counter(std::string name) -> CounterToken;
+
+    void sample(CounterToken const& t, double value);
+    auto get_counter(CounterToken const& t) const -> Counter const&;
+
+    auto counters() const -> std::vector<Counter> const&;
+
 private:
     std::vector<Entry> m_entries;
+    std::vector<Counter> m_counters;
 };
 
 
@@ -97,6 +149,10 @@ inline constexpr Token::Token(std::size_t i)
     : m_index{i}
 {}
 
+inline constexpr CounterToken::CounterToken(std::size_t i)
+    : m_index{i}
+{}
+
 
 inline Entry::Entry(std::string name)
     : name{std::move(name)}
@@ -153,6 +209,32 @@ inline auto Entry::stddev() const -> D
 }
 
 
+inline Counter::Counter(std::string name)
+    : name{std::move(name)}
+    , n_samples{0}
+    , sum{0.0}
+    , minimum{std::numeric_limits<double>::max()}
+    , maximum{std::numeric_limits<double>::lowest()}
+    , r_mean{0.0}
+    , r_var{0.0}
+{}
+
+inline auto Counter::mean() const -> double
+{
+    return r_mean;
+}
+
+inline auto Counter::var() const -> double
+{
+    return n_samples > 1 ? r_var / (n_samples - 1) : 0.0;
+}
+
+inline auto Counter::stddev() const -> double
+{
+    return std::sqrt(var());
+}
+
+
 inline measurement::measurement(Entry& e, clock::time_point start)
     : m_entry{e}
     , m_start{start}
@@ -216,4 +298,35 @@ inline auto Registry::entries() const -> std::vector<Entry> const&
     return m_entries;
 }
 
+inline auto Registry::create_counter(std::string name) -> CounterToken
+{
+    m_counters.emplace_back(std::move(name));
+    return CounterToken { m_counters.size() - 1 };
+}
+
+inline void Registry::sample(CounterToken const& t, double value)
+{
+    auto& c = m_counters[t.m_index];
+
+    c.n_samples += 1;
+    c.sum += value;
+    c.minimum = std::min(c.minimum, value);
+    c.maximum = std::max(c.maximum, value);
+
+    double const r_mean_old = c.r_mean;
+
+    c.r_mean = r_mean_old + (value - r_mean_old) / c.n_samples;
+    c.r_var = c.r_var + (value - r_mean_old) * (value - c.r_mean);
+}
+
+inline auto Registry::get_counter(CounterToken const& t) const -> Counter const&
+{
+    return m_counters[t.m_index];
+}
+
+inline auto Registry::counters() const -> std::vector<Counter> const&
+{
+    return m_counters;
+}
+
 } /* namespace iptsd::eval::perf */
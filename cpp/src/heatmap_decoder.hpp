@@ -0,0 +1,157 @@
+#pragma once
+
+/*
+ * Conversion of raw heatmap reports to images.
+ *
+ * Raw samples are inverted and normalized to [0, 1] based on the z_min and
+ * z_max values of the last heatmap dimension report. Empty or inverted
+ * ranges decode to all zeros, same as in alg::fixed::scale(). As these only change
+ * rarely, the normalized value of each of the 256 possible samples is kept in
+ * a lookup table, which is rebuilt on change.
+ */
+
+#include "parser.hpp"
+#include "types.hpp"
+
+#include "container/image.hpp"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd {
+
+class HeatmapDecoder {
+public:
+    HeatmapDecoder();
+
+    void set_dim(IptsHeatmapDim const& dim);
+
+    auto dim() const -> IptsHeatmapDim const&;
+    auto size() const -> index2_t;
+
+    void decode(Image<f32>& out, gsl::span<const std::byte> data) const;
+    void decode(Image<u8>& out, gsl::span<const std::byte> data) const;
+
+private:
+    void update_table();
+
+private:
+    IptsHeatmapDim m_dim;
+    std::array<f32, 256> m_table;
+};
+
+
+inline HeatmapDecoder::HeatmapDecoder()
+    : m_dim{}
+    , m_table{}
+{
+    update_table();
+}
+
+/*
+ * Set the heatmap dimensions, only rebuilds the table if z_min or z_max
+ * changed.
+ */
+inline void HeatmapDecoder::set_dim(IptsHeatmapDim const& dim)
+{
+    bool const changed = dim.z_min != m_dim.z_min || dim.z_max != m_dim.z_max;
+
+    m_dim = dim;
+
+    if (changed) {
+        update_table();
+    }
+}
+
+inline auto HeatmapDecoder::dim() const -> IptsHeatmapDim const&
+{
+    return m_dim;
+}
+
+inline auto HeatmapDecoder::size() const -> index2_t
+{
+    return { m_dim.width, m_dim.height };
+}
+
+inline void HeatmapDecoder::update_table()
+{
+    auto const n = static_cast<f32>(m_dim.z_max - m_dim.z_min);
+
+    // no range, e.g. before the first dimension report, decode to all zeros
+    // instead of inf/NaN, which are not allowed with -ffast-math; an
+    // inverted range is treated the same, as the fixed-point path can only
+    // handle positive scales
+    if (m_dim.z_max <= m_dim.z_min) {
+        m_table.fill(0.0f);
+        return;
+    }
+
+    for (int v = 0; v < 256; ++v) {
+        auto const x = static_cast<f32>(v - m_dim.z_min);
+
+        m_table[v] = 1.0f - x / n;
+    }
+}
+
+/*
+ * Decode a heatmap to normalized values. The payload must contain exactly
+ * one sample per pixel of out, in row-major order.
+ */
+inline void HeatmapDecoder::decode(Image<f32>& out, gsl::span<const std::byte> data) const
+{
+    auto const size = out.size();
+
+    assert(data.size() == static_cast<std::size_t>(size.span()));
+
+    auto const* in = reinterpret_cast<u8 const*>(data.data());
+    auto const* lut = m_table.data();
+
+    for (index_t y = 0; y < size.y; ++y) {
+        f32* const row = out.data() + y * out.stride();
+        u8 const* const src = in + y * size.x;
+
+        index_t x = 0;
+
+#if defined(__AVX2__)
+        // 8 table lookups per gather, indexed by the zero-extended samples
+        for (; x + 8 <= size.x; x += 8) {
+            auto const s = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + x));
+            auto const v = _mm256_i32gather_ps(lut, _mm256_cvtepu8_epi32(s), sizeof(f32));
+
+            _mm256_storeu_ps(row + x, v);
+        }
+#endif
+
+        for (; x < size.x; ++x) {
+            row[x] = lut[src[x]];
+        }
+    }
+}
+
+/*
+ * Copy the raw samples, e.g. for TouchProcessor::process(Image<u8>, ...),
+ * which takes the z_min and z_max values of dim().
+ */
+inline void HeatmapDecoder::decode(Image<u8>& out, gsl::span<const std::byte> data) const
+{
+    auto const size = out.size();
+
+    assert(data.size() == static_cast<std::size_t>(size.span()));
+
+    auto const* in = reinterpret_cast<u8 const*>(data.data());
+
+    for (index_t y = 0; y < size.y; ++y) {
+        std::copy(in + y * size.x, in + (y + 1) * size.x, out.data() + y * out.stride());
+    }
+}
+
+} /* namespace iptsd */
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::math {
+
+/*
+ * Range of exp_approx(): arguments below -exp_max<T> yield zero, arguments
+ * above exp_max<T> are clamped, so that 2^n always stays a normal number.
+ */
+template<class T>
+inline constexpr T exp_max = T {};
+
+template<>
+inline constexpr f32 exp_max<f32> = 87.0f;
+
+template<>
+inline constexpr f64 exp_max<f64> = 708.0;
+
+
+namespace impl {
+
+template<class T>
+struct ExpCoeffs {};
+
+/*
+ * Cody-Waite split of ln(2) and Taylor coefficients 1/k! of exp(r) for
+ * |r| <= ln(2)/2, with a truncation error of about one ulp.
+ */
+template<>
+struct ExpCoeffs<f32> {
+    static inline constexpr f32 log2e  = 1.44269504088896341f;
+    static inline constexpr f32 ln2_hi = 0.693359375f;
+    static inline constexpr f32 ln2_lo = -2.12194440e-4f;
+
+    static inline constexpr int n_bits = 23;
+    static inline constexpr int bias = 127;
+
+    static inline constexpr f32 c[] = {
+        1.0f, 1.0f, 1.0f / 2.0f, 1.0f / 6.0f, 1.0f / 24.0f, 1.0f / 120.0f, 1.0f / 720.0f,
+    };
+};
+
+template<>
+struct ExpCoeffs<f64> {
+    static inline constexpr f64 log2e  = 1.44269504088896341;
+    static inline constexpr f64 ln2_hi = 6.93147180369123816490e-01;
+    static inline constexpr f64 ln2_lo = 1.90821492927058770002e-10;
+
+    static inline constexpr int n_bits = 52;
+    static inline constexpr int bias = 1023;
+
+    static inline constexpr f64 c[] = {
+        1.0, 1.0, 1.0 / 2.0, 1.0 / 6.0, 1.0 / 24.0, 1.0 / 120.0, 1.0 / 720.0, 1.0 / 5040.0,
+        1.0 / 40320.0, 1.0 / 362880.0, 1.0 / 3628800.0, 1.0 / 39916800.0, 1.0 / 479001600.0,
+    };
+};
+
+template<class T>
+inline constexpr index_t exp_degree = std::extent_v<decltype(ExpCoeffs<T>::c)> - 1;
+
+
+#if defined(__AVX2__)
+
+inline auto exp_approx(__m256 x) -> __m256
+{
+    using C = ExpCoeffs<f32>;
+
+    auto const zero = _mm256_cmp_ps(x, _mm256_set1_ps(-exp_max<f32>), _CMP_LT_OQ);
+
+    x = _mm256_max_ps(x, _mm256_set1_ps(-exp_max<f32>));
+    x = _mm256_min_ps(x, _mm256_set1_ps(exp_max<f32>));
+
+    // x = n ln(2) + r
+    auto const n = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(C::log2e)),
+                                                 _mm256_set1_ps(0.5f)));
+
+    auto r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(C::ln2_hi)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(C::ln2_lo)));
+
+    // exp(r)
+    auto p = _mm256_set1_ps(C::c[exp_degree<f32>]);
+    for (index_t k = exp_degree<f32> - 1; k >= 0; --k) {
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(C::c[k]));
+    }
+
+    // 2^n
+    auto e = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(C::bias));
+    e = _mm256_slli_epi32(e, C::n_bits);
+
+    return _mm256_andnot_ps(zero, _mm256_mul_ps(p, _mm256_castsi256_ps(e)));
+}
+
+inline auto exp_approx(__m256d x) -> __m256d
+{
+    using C = ExpCoeffs<f64>;
+
+    auto const zero = _mm256_cmp_pd(x, _mm256_set1_pd(-exp_max<f64>), _CMP_LT_OQ);
+
+    x = _mm256_max_pd(x, _mm256_set1_pd(-exp_max<f64>));
+    x = _mm256_min_pd(x, _mm256_set1_pd(exp_max<f64>));
+
+    // x = n ln(2) + r
+    auto const n = _mm256_floor_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(C::log2e)),
+                                                 _mm256_set1_pd(0.5)));
+
+    auto r = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(C::ln2_hi)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(n, _mm256_set1_pd(C::ln2_lo)));
+
+    // exp(r)
+    auto p = _mm256_set1_pd(C::c[exp_degree<f64>]);
+    for (index_t k = exp_degree<f64> - 1; k >= 0; --k) {
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(C::c[k]));
+    }
+
+    // 2^n
+    auto e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    e = _mm256_add_epi64(e, _mm256_set1_epi64x(C::bias));
+    e = _mm256_slli_epi64(e, C::n_bits);
+
+    return _mm256_andnot_pd(zero, _mm256_mul_pd(p, _mm256_castsi256_pd(e)));
+}
+
+#endif
+
+} /* namespace impl */
+
+
+/**
+ * exp_approx() - Approximate exponential function.
+ * @x: The argument.
+ *
+ * Computes exp(x) via range reduction to |r| <= ln(2)/2 and a polynomial,
+ * with a relative error of a few ulp. Returns zero for x < -exp_max<T>,
+ * instead of a subnormal number.
+ */
+template<class T>
+inline auto exp_approx(T x) -> T
+{
+    using C = impl::ExpCoeffs<T>;
+
+    if (x < -exp_max<T>) {
+        return static_cast<T>(0);
+    }
+
+    x = std::min(x, exp_max<T>);
+
+    auto const n = std::floor(x * C::log2e + static_cast<T>(0.5));
+    auto const r = (x - n * C::ln2_hi) - n * C::ln2_lo;
+
+    auto p = C::c[impl::exp_degree<T>];
+    for (index_t k = impl::exp_degree<T> - 1; k >= 0; --k) {
+        p = p * r + C::c[k];
+    }
+
+    return std::ldexp(p, static_cast<int>(n));
+}
+
+/**
+ * exp_approx() - Approximate exponential function of multiple values.
+ * @out: Output values.
+ * @in:  Arguments, may alias out.
+ * @n:   Number of values.
+ *
+ * Same as the scalar exp_approx(), but processes full SIMD vectors at once.
+ */
+template<class T>
+inline void exp_approx(T* out, T const* in, index_t n)
+{
+    index_t i = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f32>) {
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, impl::exp_approx(_mm256_loadu_ps(in + i)));
+        }
+    }
+
+    if constexpr (std::is_same_v<T, f64>) {
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(out + i, impl::exp_approx(_mm256_loadu_pd(in + i)));
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        out[i] = exp_approx(in[i]);
+    }
+}
+
+} /* namespace iptsd::math */
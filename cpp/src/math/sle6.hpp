@@ -4,6 +4,15 @@
 #include "math/vec6.hpp"
 #include "math/mat6.hpp"
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 
 namespace iptsd::math {
 
@@ -215,4 +224,261 @@ auto ge_solve(Mat6<T> a, Vec6<T> b, Vec6<T>& x, T eps=num<T>::eps) -> bool
     return true;
 }
 
+
+namespace impl {
+
+/*
+ * Values of N independent systems, one per SIMD lane. The operators are
+ * plain element-wise loops over a full vector register, which the compiler
+ * maps to single vector instructions.
+ */
+template<class T, std::size_t N>
+struct Lanes {
+    alignas(N * sizeof(T)) std::array<T, N> v;
+
+    Lanes() = default;
+
+    explicit Lanes(T s)
+    {
+        v.fill(s);
+    }
+};
+
+template<class T, std::size_t N>
+inline auto operator- (Lanes<T, N> const& a, Lanes<T, N> const& b) -> Lanes<T, N>
+{
+    auto r = Lanes<T, N> {};
+    for (std::size_t i = 0; i < N; ++i) {
+        r.v[i] = a.v[i] - b.v[i];
+    }
+    return r;
+}
+
+template<class T, std::size_t N>
+inline auto operator* (Lanes<T, N> const& a, Lanes<T, N> const& b) -> Lanes<T, N>
+{
+    auto r = Lanes<T, N> {};
+    for (std::size_t i = 0; i < N; ++i) {
+        r.v[i] = a.v[i] * b.v[i];
+    }
+    return r;
+}
+
+template<class T, std::size_t N>
+inline auto operator/ (Lanes<T, N> const& a, Lanes<T, N> const& b) -> Lanes<T, N>
+{
+    auto r = Lanes<T, N> {};
+    for (std::size_t i = 0; i < N; ++i) {
+        r.v[i] = a.v[i] / b.v[i];
+    }
+    return r;
+}
+
+/*
+ * Collect one value of each of the N systems into lanes. Building the vector
+ * in registers avoids a store-forwarding stall on each subsequent load, as
+ * caused by writing the lanes individually.
+ */
+template<class T, std::size_t N, class F>
+inline auto gather(F get) -> Lanes<T, N>
+{
+    auto r = Lanes<T, N> {};
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, f64> && N == 4) {
+        _mm256_store_pd(r.v.data(), _mm256_setr_pd(get(0), get(1), get(2), get(3)));
+        return r;
+    }
+
+    if constexpr (std::is_same_v<T, f32> && N == 8) {
+        _mm256_store_ps(r.v.data(), _mm256_setr_ps(get(0), get(1), get(2), get(3),
+                                                   get(4), get(5), get(6), get(7)));
+        return r;
+    }
+#endif
+
+    for (std::size_t k = 0; k < N; ++k) {
+        r.v[k] = get(k);
+    }
+
+    return r;
+}
+
+/*
+ * Unrolled LDL^T-decomposition of the symmetric matrix A, using only its
+ * lower triangle, followed by solving Ax = b. Works on scalars and Lanes
+ * alike. Does not check for breakdown, instead returns the diagonal of D,
+ * which the caller must check via ldlt_valid() before using x.
+ */
+template<class V>
+inline void ldlt(Mat6<V> const& a, Vec6<V> const& b, Vec6<V>& x, Vec6<V>& d)
+{
+    // step 1: decomposition A = LDL^T
+    d[0] = a[{0, 0}];
+    auto const r0 = static_cast<V>(1) / d[0];
+    auto const l10 = a[{1, 0}] * r0;
+    auto const l20 = a[{2, 0}] * r0;
+    auto const l30 = a[{3, 0}] * r0;
+    auto const l40 = a[{4, 0}] * r0;
+    auto const l50 = a[{5, 0}] * r0;
+
+    auto const w10 = l10 * d[0];
+    d[1] = a[{1, 1}] - l10 * w10;
+    auto const r1 = static_cast<V>(1) / d[1];
+    auto const l21 = (a[{2, 1}] - l20 * w10) * r1;
+    auto const l31 = (a[{3, 1}] - l30 * w10) * r1;
+    auto const l41 = (a[{4, 1}] - l40 * w10) * r1;
+    auto const l51 = (a[{5, 1}] - l50 * w10) * r1;
+
+    auto const w20 = l20 * d[0];
+    auto const w21 = l21 * d[1];
+    d[2] = a[{2, 2}] - l20 * w20 - l21 * w21;
+    auto const r2 = static_cast<V>(1) / d[2];
+    auto const l32 = (a[{3, 2}] - l30 * w20 - l31 * w21) * r2;
+    auto const l42 = (a[{4, 2}] - l40 * w20 - l41 * w21) * r2;
+    auto const l52 = (a[{5, 2}] - l50 * w20 - l51 * w21) * r2;
+
+    auto const w30 = l30 * d[0];
+    auto const w31 = l31 * d[1];
+    auto const w32 = l32 * d[2];
+    d[3] = a[{3, 3}] - l30 * w30 - l31 * w31 - l32 * w32;
+    auto const r3 = static_cast<V>(1) / d[3];
+    auto const l43 = (a[{4, 3}] - l40 * w30 - l41 * w31 - l42 * w32) * r3;
+    auto const l53 = (a[{5, 3}] - l50 * w30 - l51 * w31 - l52 * w32) * r3;
+
+    auto const w40 = l40 * d[0];
+    auto const w41 = l41 * d[1];
+    auto const w42 = l42 * d[2];
+    auto const w43 = l43 * d[3];
+    d[4] = a[{4, 4}] - l40 * w40 - l41 * w41 - l42 * w42 - l43 * w43;
+    auto const r4 = static_cast<V>(1) / d[4];
+    auto const l54 = (a[{5, 4}] - l50 * w40 - l51 * w41 - l52 * w42 - l53 * w43) * r4;
+
+    auto const w50 = l50 * d[0];
+    auto const w51 = l51 * d[1];
+    auto const w52 = l52 * d[2];
+    auto const w53 = l53 * d[3];
+    auto const w54 = l54 * d[4];
+    d[5] = a[{5, 5}] - l50 * w50 - l51 * w51 - l52 * w52 - l53 * w53 - l54 * w54;
+    auto const r5 = static_cast<V>(1) / d[5];
+
+    // step 2: solve Lz = b for z (forward substitution)
+    auto const z0 = b[0];
+    auto const z1 = b[1] - l10 * z0;
+    auto const z2 = b[2] - l20 * z0 - l21 * z1;
+    auto const z3 = b[3] - l30 * z0 - l31 * z1 - l32 * z2;
+    auto const z4 = b[4] - l40 * z0 - l41 * z1 - l42 * z2 - l43 * z3;
+    auto const z5 = b[5] - l50 * z0 - l51 * z1 - l52 * z2 - l53 * z3 - l54 * z4;
+
+    // step 3: solve DL^Tx = z for x (backward substitution)
+    x[5] = z5 * r5;
+    x[4] = z4 * r4 - l54 * x[5];
+    x[3] = z3 * r3 - l53 * x[5] - l43 * x[4];
+    x[2] = z2 * r2 - l52 * x[5] - l42 * x[4] - l32 * x[3];
+    x[1] = z1 * r1 - l51 * x[5] - l41 * x[4] - l31 * x[3] - l21 * x[2];
+    x[0] = z0 * r0 - l50 * x[5] - l40 * x[4] - l30 * x[3] - l20 * x[2] - l10 * x[1];
+}
+
+/*
+ * Check the diagonal of D returned by ldlt() for breakdown, relative to the
+ * diagonal of A. The decomposition is stable if all pivots are positive and
+ * not too small, i.e. if A is sufficiently positive definite.
+ */
+template<class T>
+inline auto ldlt_valid(Mat6<T> const& a, Vec6<T> const& d, T eps) -> bool
+{
+    auto const rtol = static_cast<T>(64) * std::numeric_limits<T>::epsilon();
+
+    bool ok = true;
+    for (index_t i = 0; i < 6; ++i) {
+        ok &= d[i] > std::max(eps, rtol * a[{i, i}]);
+    }
+
+    return ok;
+}
+
+} /* namespace impl */
+
+
+// number of systems solved together by ldlt_solve_batch(), i.e. the number of
+// values per 256 bit vector register
+template<class T>
+inline constexpr std::size_t ldlt_batch_size = 32 / sizeof(T);
+
+/**
+ * ldlt_solve() - Solve a symmetric system of linear equations via LDL^T-decomposition.
+ * @a: The symmetric system matrix A.
+ * @b: The right-hand-side vector b.
+ * @x: The vector to solve for.
+ *
+ * Solves the system of linear equations Ax = b for a symmetric positive
+ * definite matrix A, e.g. the normal equations of a least-squares problem.
+ * Does not pivot. Falls back to ge_solve() if the decomposition breaks down.
+ */
+template<class T>
+auto ldlt_solve(Mat6<T> const& a, Vec6<T> const& b, Vec6<T>& x, T eps=num<T>::eps) -> bool
+{
+    auto d = Vec6<T> {};
+
+    impl::ldlt(a, b, x, d);
+
+    if (impl::ldlt_valid(a, d, eps)) {
+        return true;
+    }
+
+    return ge_solve(a, b, x, eps);
+}
+
+/**
+ * ldlt_solve_batch() - Solve multiple symmetric systems of linear equations.
+ * @a:  The symmetric system matrices.
+ * @b:  The right-hand-side vectors.
+ * @x:  The vectors to solve for.
+ * @ok: Whether the respective system could be solved.
+ * @n:  The number of systems, at most N.
+ *
+ * Same as ldlt_solve(), but decomposes and solves all systems together, one
+ * per SIMD lane. Systems for which the decomposition breaks down are solved
+ * individually via ge_solve().
+ */
+template<class T, std::size_t N>
+void ldlt_solve_batch(std::array<Mat6<T>, N> const& a, std::array<Vec6<T>, N> const& b,
+                      std::array<Vec6<T>, N>& x, std::array<bool, N>& ok, std::size_t n,
+                      T eps=num<T>::eps)
+{
+    using V = impl::Lanes<T, N>;
+
+    Mat6<V> la;
+    Vec6<V> lb;
+    Vec6<V> lx;
+    Vec6<V> ld;
+
+    // transpose into lanes, unused lanes solve Ix = 0 so that they stay
+    // finite, their results are ignored
+    for (index_t i = 0; i < 6; ++i) {
+        for (index_t j = 0; j <= i; ++j) {
+            la[{i, j}] = impl::gather<T, N>([&](std::size_t k) {
+                return k < n ? a[k][{i, j}] : (i == j ? num<T>::one : num<T>::zero);
+            });
+        }
+
+        lb[i] = impl::gather<T, N>([&](std::size_t k) {
+            return k < n ? b[k][i] : num<T>::zero;
+        });
+    }
+
+    impl::ldlt(la, lb, lx, ld);
+
+    for (std::size_t k = 0; k < n; ++k) {
+        auto d = Vec6<T> {};
+
+        for (index_t i = 0; i < 6; ++i) {
+            x[k][i] = lx[i].v[k];
+            d[i] = ld[i].v[k];
+        }
+
+        ok[k] = impl::ldlt_valid(a[k], d, eps) || ge_solve(a[k], b[k], x[k], eps);
+    }
+}
+
 } /* namespace iptsd::math */
@@ -4,14 +4,16 @@
 
 #include "algorithm/convolution.hpp"
 #include "algorithm/distance_transform.hpp"
+#include "algorithm/eigenvalues.hpp"
 #include "algorithm/gaussian_fitting.hpp"
-#include "algorithm/hessian.hpp"
 #include "algorithm/label.hpp"
 #include "algorithm/local_maxima.hpp"
-#include "algorithm/structure_tensor.hpp"
+#include "algorithm/preprocessing.hpp"
+#include "algorithm/structure_tensor_hessian.hpp"
 
 #include "container/image.hpp"
 #include "container/kernel.hpp"
+#include "container/tensor_image.hpp"
 #include "container/ops.hpp"
 
 #include "eval/perf.hpp"
@@ -22,20 +24,94 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <vector>
 #include <queue>
+#include <thread>
+#include <tuple>
 
 
 namespace iptsd {
 
-TouchProcessor::TouchProcessor(index2_t size)
-    : m_perf_reg{}
+TouchProcessor::Region::Region(index2_t size, TouchProcessorConfig const& config, role_type role)
+    : offset{0, 0}
+    , label_engine{config.label_engine}
+    , role{role}
+    , pp{}
+    , st_1{}
+    , st_2{}
+    , hs_1{}
+    , hs_2{}
+    , grd{}
+    , coh{}
+    , rdg{}
+    , obj{}
+    , lbl{}
+    , lbl_forest{{ 0, 0 }, Layout { 1, false }}
+    , lbl_runs{}
+    , dm1{}
+    , dm2{}
+    , n_labels{0}
+    , maximas{32}
+    , cstats{32}
+    , cscore{32}
+{
+    this->resize(size);
+}
+
+/*
+ * Resize the buffers used by the configuration and role. Their storage only
+ * grows, rounded up to the block grid of alg::roi::find_regions(), so that
+ * pooled regions can be reused across frames without reallocating each time
+ * the size of their bounding box changes.
+ */
+void TouchProcessor::Region::resize(index2_t size)
+{
+    constexpr auto n = alg::roi::block_size;
+
+    auto const capacity = index2_t { (size.x + n - 1) / n * n, (size.y + n - 1) / n * n };
+
+    auto const fit = [&](auto& img) {
+        img.reserve(capacity);
+        img.resize(size);
+    };
+
+    fit(pp);
+    fit(grd);
+    fit(coh);
+    fit(rdg);
+    fit(obj);
+    fit(st_1);
+    fit(st_2);
+    fit(hs_1);
+    fit(hs_2);
+
+    // labels and distance transform only run on the full frame or regions
+    if (role == role_type::dense) {
+        return;
+    }
+
+    fit(lbl);
+    fit(dm1);
+    fit(dm2);
+
+    if (label_engine == label_engine_type::pixels) {
+        fit(lbl_forest);
+    }
+}
+
+
+TouchProcessor::TouchProcessor(index2_t size, TouchProcessorConfig const& config)
+    : m_config{config}
+    , m_perf_reg{}
     , m_perf_t_total{m_perf_reg.create_entry("total")}
     , m_perf_t_prep{m_perf_reg.create_entry("preprocessing")}
-    , m_perf_t_st{m_perf_reg.create_entry("structure-tensor")}
     , m_perf_t_stev{m_perf_reg.create_entry("structure-tensor.eigenvalues")}
-    , m_perf_t_hess{m_perf_reg.create_entry("hessian")}
+    , m_perf_t_drv{m_perf_reg.create_entry("structure-tensor+hessian")}
     , m_perf_t_rdg{m_perf_reg.create_entry("ridge")}
     , m_perf_t_obj{m_perf_reg.create_entry("objective")}
     , m_perf_t_lmax{m_perf_reg.create_entry("objective.maximas")}
@@ -45,37 +121,465 @@ TouchProcessor::TouchProcessor(index2_t size)
     , m_perf_t_flt{m_perf_reg.create_entry("filter")}
     , m_perf_t_lmaxf{m_perf_reg.create_entry("filter.maximas")}
     , m_perf_t_gfit{m_perf_reg.create_entry("gaussian-fitting")}
-    , m_img_pp{size}
-    , m_img_m2_1{size}
-    , m_img_m2_2{size}
-    , m_img_stev{size}
-    , m_img_rdg{size}
-    , m_img_obj{size}
-    , m_img_lbl{size}
-    , m_img_dm1{size}
-    , m_img_dm2{size}
-    , m_img_flt{size}
-    , m_img_gftmp{size}
+    , m_perf_t_roi{m_perf_reg.create_entry("roi")}
+    , m_perf_c_roi_skip{m_perf_reg.create_counter("roi.skipped-pixels")}
+    , m_perf_c_exit_idle{m_perf_reg.create_counter("exit.no-maximas")}
+    , m_perf_c_exit_rejected{m_perf_reg.create_counter("exit.all-excluded")}
+    , m_perf_c_gfit_iter{m_perf_reg.create_counter("gaussian-fitting.iterations")}
+    , m_frame{size, config}
+    , m_roi_pool{}
+    , m_regions{}
+    , m_roi_bounds{}
+    , m_roi_bounds_prev{}
+    , m_band_pool{}
+    , m_band_bounds{}
+    , m_tiles{}
+    , m_img_pp_fx{size, Layout { 1, true }}
+    , m_img_flt{size, Layout { 1, true }}
+    , m_img_gftmp_f32{size}
+    , m_img_gftmp_f64{size}
     , m_wdt_queue{}
-    , m_gf_params{}
+    , m_wdt_rqueue{512}
+    , m_gf_params_f32{}
+    , m_gf_params_f64{}
     , m_maximas{32}
-    , m_cstats{32}
-    , m_cscore{32}
-    , m_kern_pp{alg::conv::kernels::gaussian<f32, 5, 5>(0.9f)}
-    , m_kern_st{alg::conv::kernels::gaussian<f32, 5, 5>(1.0f)}
-    , m_kern_hs{alg::conv::kernels::gaussian<f32, 5, 5>(1.0f)}
-    , m_gf_window{11, 11}
+    , m_contacts{}
+    , m_pool{}
+    , m_kern_pp{alg::conv::kernels::gaussian_separable<f32, 5, 5>(0.9f)}
+    , m_kern_st{alg::conv::kernels::gaussian_separable<f32, 5, 5>(1.0f)}
+    , m_kern_hs{alg::conv::kernels::gaussian_separable<f32, 5, 5>(1.0f)}
+    , m_kern_pp_fx{alg::fixed::quantize(m_kern_pp)}
+    , m_gf_warm_dist{2.0f}
+    , m_prep_avg{}
+    , m_gf_prev{}
+    , m_pp_fx_scale{}
     , m_touchpoints{}
 {
-    m_wdt_queue = std::priority_queue { std::less<alg::wdt::QItem<f32>>(), [](){
+    m_wdt_queue = std::priority_queue { std::greater<alg::wdt::QItem<f32>>(), [](){
         auto buf = std::vector<alg::wdt::QItem<f32>>{};
         buf.reserve(512);
         return buf;
     }() };
 
-    alg::gfit::reserve(m_gf_params, 32, size);
+    // the number of fitted contacts is limited, so this never needs to grow
+    auto const n_contacts = static_cast<std::size_t>(std::max(m_config.max_contacts, 0));
+
+    alg::gfit::reserve(m_gf_params_f32, n_contacts);
+    alg::gfit::reserve(m_gf_params_f64, n_contacts);
+
+    // in ROI mode, only pixels inside of regions are written, the rest is zero
+    for (index_t y = 0; y < m_img_flt.size().y; ++y) {
+        std::fill_n(m_img_flt.row(y), m_img_flt.size().x, 0.0f);
+    }
+
+    // the halo is never written, so local maxima can be found without border checks
+    m_img_flt.fill_halo(std::numeric_limits<f32>::lowest());
+    m_img_pp_fx.fill_halo(std::numeric_limits<i16>::lowest());
 
+    m_regions.reserve(16);
+    m_roi_pool.reserve(16);
+    m_roi_bounds.reserve(64);
+    m_roi_bounds_prev.reserve(64);
+
+    m_contacts.reserve(64);
+    m_gf_prev.reserve(32);
     m_touchpoints.reserve(32);
+
+    // more threads than cores would only wait for each other
+    auto const n_cores = static_cast<index_t>(std::thread::hardware_concurrency());
+    auto const n_threads = n_cores > 0 ? std::min(m_config.threads, n_cores) : m_config.threads;
+
+    if (n_threads > 1) {
+        m_pool.emplace(static_cast<std::size_t>(n_threads));
+    }
+
+    // row bands, each extended by the margin to be processed independently
+    if (!m_config.roi && m_config.bands > 1) {
+        auto const n = std::min(m_config.bands, size.y);
+        auto const h = margin();
+
+        m_band_pool.reserve(n);
+        m_band_bounds.reserve(n);
+
+        for (index_t i = 0; i < n; ++i) {
+            auto const y0 = size.y * i / n;
+            auto const y1 = size.y * (i + 1) / n - 1;
+
+            auto const ymin = std::max(y0 - h, 0);
+            auto const ymax = std::min(y1 + h, size.y - 1);
+
+            auto& r = m_band_pool.emplace_back(index2_t { size.x, ymax - ymin + 1 }, m_config,
+                                               Region::role_type::dense);
+            r.offset = { 0, ymin };
+
+            m_band_bounds.push_back({ 0, size.x - 1, y0, y1 });
+        }
+    }
+}
+
+/*
+ * Support of the dense stages, i.e. the number of pixels by which their
+ * output depends on input pixels: 3x3 derivatives plus smoothing.
+ */
+auto TouchProcessor::margin() const -> index_t
+{
+    auto const k = std::max({
+        m_kern_st.size().x, m_kern_st.size().y,
+        m_kern_hs.size().x, m_kern_hs.size().y,
+    });
+
+    return 1 + (k - 1) / 2;
+}
+
+/*
+ * Select the regions on which the stages from the local maxima onwards are
+ * run for this frame, and the tiles on which the dense stages are run.
+ *
+ * In full-frame mode, the only region is the full frame. Its dense stages
+ * either run on the full frame as well, or on row bands extended by the
+ * margin, so that the rows owned by each band are the same as for the full
+ * frame, and are merged back by merge_bands().
+ *
+ * In ROI mode, these are the regions around all pixels with a positive
+ * preprocessed value. All later stages only depend on those pixels and
+ * their neighborhood: The structure tensor and hessian are zero more than
+ * one pixel away from them and smoothing spreads this by the kernel radius,
+ * labels and distance transform only cover positive pixels, and the filter
+ * output is zero everywhere else. Thus, with a margin of the combined
+ * support, processing the regions yields the same result as processing the
+ * full frame.
+ */
+void TouchProcessor::update_regions()
+{
+    m_regions.clear();
+    m_tiles.clear();
+
+    if (!m_config.roi) {
+        m_regions.push_back(&m_frame);
+
+        if (m_band_pool.empty()) {
+            m_tiles.push_back(&m_frame);
+            return;
+        }
+
+        for (auto& r : m_band_pool) {
+            for (index_t y = 0; y < r.size().y; ++y) {
+                auto const* const src = m_frame.pp.data() + (r.offset.y + y) * m_frame.pp.stride();
+                std::copy(src, src + r.size().x, r.pp.data() + y * r.pp.stride());
+            }
+
+            m_tiles.push_back(&r);
+        }
+
+        return;
+    }
+
+    // the filter output of the previous regions may not be covered anymore
+    for (auto const& b : m_roi_bounds_prev) {
+        for (index_t y = b.ymin; y <= b.ymax; ++y) {
+            auto* const row = m_img_flt.data() + y * m_img_flt.stride();
+            std::fill(row + b.xmin, row + b.xmax + 1, 0.0f);
+        }
+    }
+
+    alg::roi::find_regions(m_roi_bounds, m_frame.pp, 0.0f, margin());
+
+    index_t n_active = 0;
+
+    for (std::size_t i = 0; i < m_roi_bounds.size(); ++i) {
+        auto const& b = m_roi_bounds[i];
+        auto const size = alg::roi::size(b);
+
+        // re-use storage of previous frames where possible
+        if (i >= m_roi_pool.size()) {
+            m_roi_pool.emplace_back(size, m_config);
+        } else {
+            m_roi_pool[i].resize(size);
+        }
+
+        auto& r = m_roi_pool[i];
+        r.offset = { b.xmin, b.ymin };
+
+        for (index_t y = 0; y < size.y; ++y) {
+            auto const* const src = m_frame.pp.data() + (b.ymin + y) * m_frame.pp.stride() + b.xmin;
+            std::copy(src, src + size.x, r.pp.data() + y * r.pp.stride());
+        }
+
+        n_active += size.span();
+    }
+
+    // only take pointers once the pool does not grow anymore
+    for (std::size_t i = 0; i < m_roi_bounds.size(); ++i) {
+        m_regions.push_back(&m_roi_pool[i]);
+    }
+
+    m_tiles = m_regions;
+
+    std::swap(m_roi_bounds, m_roi_bounds_prev);
+
+    auto const n_total = m_frame.size().span();
+    m_perf_reg.sample(m_perf_c_roi_skip, static_cast<f64>(n_total - n_active) / n_total);
+}
+
+/*
+ * Copy the rows owned by each band from the outputs of the dense stages
+ * into the full frame.
+ */
+void TouchProcessor::merge_bands()
+{
+    auto const merge = [](Image<f32>& dst, Image<f32> const& src, index_t y0, index_t y1, index_t dy) {
+        for (index_t y = y0; y <= y1; ++y) {
+            auto const* const row = src.data() + (y - dy) * src.stride();
+            std::copy(row, row + src.size().x, dst.data() + y * dst.stride());
+        }
+    };
+
+    for (std::size_t i = 0; i < m_band_pool.size(); ++i) {
+        auto const& r = m_band_pool[i];
+        auto const& b = m_band_bounds[i];
+
+        merge(m_frame.grd, r.grd, b.ymin, b.ymax, r.offset.y);
+        merge(m_frame.coh, r.coh, b.ymin, b.ymax, r.offset.y);
+        merge(m_frame.rdg, r.rdg, b.ymin, b.ymax, r.offset.y);
+        merge(m_frame.obj, r.obj, b.ymin, b.ymax, r.offset.y);
+    }
+}
+
+/*
+ * Run fn on each tile, in parallel on the worker pool if there is one. Each
+ * call is one stage, i.e. all tiles have been processed once this returns.
+ */
+template<class F>
+void TouchProcessor::for_each_tile(F fn)
+{
+    parallel_for(m_tiles.size(), [&](std::size_t i) {
+        fn(*m_tiles[i]);
+    });
+}
+
+/*
+ * Call fn(i) for all i in [0, n), in parallel on the worker pool if there is
+ * one, and return once all calls have returned.
+ */
+template<class F>
+void TouchProcessor::parallel_for(std::size_t n, F fn)
+{
+    if (!m_pool) {
+        for (std::size_t i = 0; i < n; ++i) {
+            fn(i);
+        }
+
+        return;
+    }
+
+    m_pool->run(n, fn);
+}
+
+auto TouchProcessor::find_region(index2_t p) const -> Region const*
+{
+    for (auto const* r : m_regions) {
+        auto const q = p - r->offset;
+
+        if (q.x >= 0 && q.y >= 0 && q.x < r->size().x && q.y < r->size().y)
+            return r;
+    }
+
+    return nullptr;
+}
+
+auto TouchProcessor::component_score(index2_t p) const -> f32
+{
+    auto const* r = find_region(p);
+    if (!r)
+        return 0.0f;
+
+    auto const l = r->lbl[p - r->offset];
+    return l > 0 ? r->cscore.at(l - 1) : 0.0f;
+}
+
+/*
+ * Limit the filtered maximas to the configured maximum number of contacts,
+ * keeping the ones with the highest component score and, for maximas of
+ * the same component, the highest value. This bounds the cost of the
+ * gaussian fitting for noisy frames. The selected maximas are kept in their
+ * original order.
+ */
+void TouchProcessor::limit_contacts()
+{
+    auto const n = static_cast<std::size_t>(std::max(m_config.max_contacts, 0));
+
+    if (m_maximas.size() <= n)
+        return;
+
+    m_contacts.clear();
+    for (auto const m : m_maximas) {
+        auto const p = Image<f32>::unravel(m_frame.size(), m);
+
+        m_contacts.push_back({ component_score(p), m_img_flt[p], m });
+    }
+
+    auto const rank = [](Contact const& a, Contact const& b) {
+        return std::tie(a.score, a.value) > std::tie(b.score, b.value);
+    };
+
+    std::nth_element(m_contacts.begin(), m_contacts.begin() + n, m_contacts.end(), rank);
+    m_contacts.resize(n);
+
+    std::sort(m_contacts.begin(), m_contacts.end(), [](Contact const& a, Contact const& b) {
+        return a.index < b.index;
+    });
+
+    m_maximas.clear();
+    for (auto const& c : m_contacts) {
+        m_maximas.push_back(c.index);
+    }
+}
+
+/*
+ * Early exit for frames without any included component: The filter would
+ * remove everything, so there are no contacts to fit.
+ */
+auto TouchProcessor::skip_frame() -> std::vector<TouchPoint> const&
+{
+    for (auto& p : m_gf_params_f32) {
+        p.valid = false;
+    }
+
+    for (auto& p : m_gf_params_f64) {
+        p.valid = false;
+    }
+
+    m_gf_prev.clear();
+
+    m_touchpoints.clear();
+    return m_touchpoints;
+}
+
+/*
+ * Fit gaussians to the filtered maximas, in the precision of params.
+ */
+template<class S>
+void TouchProcessor::fit_contacts(std::vector<alg::gfit::Parameters<S>>& params, Image<S>& tmp)
+{
+    if (m_maximas.empty()) {
+        for (auto& p : params) {
+            p.valid = false;
+        }
+
+        m_gf_prev.clear();
+        return;
+    }
+
+    auto _r = m_perf_reg.record(m_perf_t_gfit);
+
+    alg::gfit::reserve(params, m_maximas.size());
+
+    auto const window = alg::gfit::window_size;
+
+    for (std::size_t i = 0; i < m_maximas.size(); ++i) {
+        auto const [x, y] = Image<f32>::unravel(m_frame.size(), m_maximas[i]);
+
+        // TODO: move window inwards instead of clamping?
+        auto const bounds = alg::gfit::BBox {
+            std::max(x - (window.x - 1) / 2, 0),
+            std::min(x + (window.x - 1) / 2, m_frame.size().x - 1),
+            std::max(y - (window.y - 1) / 2, 0),
+            std::min(y + (window.y - 1) / 2, m_frame.size().y - 1),
+        };
+
+        params[i].valid  = true;
+        params[i].scale  = static_cast<S>(1);
+        params[i].mean   = { static_cast<S>(x), static_cast<S>(y) };
+        params[i].prec   = { static_cast<S>(1), static_cast<S>(0), static_cast<S>(1) };
+        params[i].bounds = bounds;
+
+        if (m_config.gfit_subpixel_start) {
+            params[i].mean = alg::refine_local_maxima(m_img_flt, { x, y }).template cast<S>();
+        }
+
+        if (!m_config.gfit_warm_start) {
+            continue;
+        }
+
+        // start from the closest unused contact of the previous frame
+        auto const m = Vec2<f64> { static_cast<f64>(x), static_cast<f64>(y) };
+
+        PrevFit* prev = nullptr;
+        f64 d_prev = static_cast<f64>(m_gf_warm_dist);
+
+        for (auto& f : m_gf_prev) {
+            auto const d = (f.mean - m).norm_l2();
+
+            if (!f.used && d <= d_prev) {
+                prev = &f;
+                d_prev = d;
+            }
+        }
+
+        if (prev) {
+            prev->used = true;
+
+            params[i].scale = static_cast<S>(prev->scale);
+            params[i].mean  = prev->mean.template cast<S>();
+            params[i].prec  = prev->prec.template cast<S>();
+        }
+    }
+
+    auto const tol = static_cast<S>(m_config.gfit_tolerance);
+    auto const n_updates = m_pool
+        ? alg::gfit::fit(params, m_img_flt, tmp, 3, tol, math::num<S>::eps, *m_pool)
+        : alg::gfit::fit(params, m_img_flt, tmp, 3, tol);
+
+    m_perf_reg.sample(m_perf_c_gfit_iter, static_cast<f64>(n_updates) / m_maximas.size());
+
+    // remember the fitted contacts for the next frame
+    m_gf_prev.clear();
+    for (auto const& p : params) {
+        if (!p.valid) {
+            continue;
+        }
+
+        m_gf_prev.push_back({ static_cast<f64>(p.scale), p.mean.template cast<f64>(),
+                              p.prec.template cast<f64>(), false });
+    }
+}
+
+template<class S>
+void TouchProcessor::generate_output(std::vector<alg::gfit::Parameters<S>> const& params)
+{
+    m_touchpoints.clear();
+    for (auto const& p : params) {
+        if (!p.valid) {
+            continue;
+        }
+
+        auto const cov = p.prec.inverse();
+        if (!cov.has_value()) {
+            spdlog::warn("failed to invert matrix");
+            continue;
+        }
+
+        auto const [ev1, ev2] = cov->eigenvalues();
+        auto const sd1 = std::sqrt(std::abs(ev1));
+        auto const sd2 = std::sqrt(std::abs(ev2));
+
+        if (sd1 <= math::num<f32>::eps || sd2 <= math::num<f32>::eps) {
+            spdlog::warn("standard deviation too small");
+            continue;
+        }
+
+        auto const aspect = std::max(sd1, sd2) / std::min(sd1, sd2);
+        if (aspect > 2.0f) {
+            continue;
+        }
+
+        auto const x = std::clamp(static_cast<index_t>(p.mean.x), 0, m_frame.size().x - 1);
+        auto const y = std::clamp(static_cast<index_t>(p.mean.y), 0, m_frame.size().y - 1);
+
+        auto const cs = component_score({ x, y });
+
+        m_touchpoints.push_back(TouchPoint { cs, static_cast<f32>(p.scale), p.mean.template cast<f32>(), cov->template cast<f32>() });
+    }
 }
 
 auto TouchProcessor::process(Image<f32> const& hm) -> std::vector<TouchPoint> const&
@@ -86,48 +590,152 @@ auto TouchProcessor::process(Image<f32> const& hm) -> std::vector<TouchPoint> co
     {
         auto _r = m_perf_reg.record(m_perf_t_prep);
 
-        alg::convolve(m_img_pp, hm, m_kern_pp);
+        auto& pp = m_frame.pp;
+        auto const n = static_cast<f32>(pp.size().span());
 
-        auto const sum = container::ops::sum(m_img_pp);
-        auto const avg = sum / m_img_pp.size().span();
+        if (m_config.prep_mean == prep_mean_type::previous && m_prep_avg.has_value()) {
+            // blur, accumulate and subtract in a single sweep
+            auto const sum = alg::convolve_sum_subtract_clamp(pp, hm, m_kern_pp, *m_prep_avg);
 
-        container::ops::transform(m_img_pp, [&](auto const x) {
-            return std::max(x - avg, 0.0f);
-        });
+            m_prep_avg = sum / n;
+        } else {
+            auto const sum = alg::convolve_sum(pp, hm, m_kern_pp);
+            auto const avg = sum / n;
+
+            alg::subtract_clamp(pp, avg);
+
+            m_prep_avg = avg;
+        }
+
+        m_pp_fx_scale.reset();
     }
 
-    // structure tensor
+    return process_frame();
+}
+
+auto TouchProcessor::process(Image<u8> const& hm, u8 z_min, u8 z_max) -> std::vector<TouchPoint> const&
+{
+    auto _tr = m_perf_reg.record(m_perf_t_total);
+
+    // preprocessing, same as above but in fixed point, only the result is
+    // converted to float
     {
-        auto _r = m_perf_reg.record(m_perf_t_st);
+        auto _r = m_perf_reg.record(m_perf_t_prep);
+
+        auto const scale = alg::fixed::scale(z_min, z_max);
+        auto const n = static_cast<f32>(m_img_pp_fx.size().span());
+
+        // offset in fixed point, saturated to i16
+        auto const quantize = [&](f32 offs) {
+            return static_cast<i16>(std::lround(std::clamp(offs / scale, -32768.0f, 32767.0f)));
+        };
+
+        if (scale == 0.0f) {
+            // empty range, decode to all zeros like HeatmapDecoder, so that
+            // the frame is skipped as idle
+            for (index_t y = 0; y < m_frame.pp.size().y; ++y) {
+                std::fill_n(m_frame.pp.row(y), m_frame.pp.size().x, 0.0f);
+            }
+
+            m_prep_avg = 0.0f;
+        } else if (m_config.prep_mean == prep_mean_type::previous && m_prep_avg.has_value()) {
+            // blur, accumulate, subtract and convert in a single sweep
+            auto const sum = alg::fixed::convolve_sum_subtract_clamp_convert(m_frame.pp, m_img_pp_fx, hm, z_max,
+                                                                             m_kern_pp_fx, quantize(*m_prep_avg),
+                                                                             scale);
+
+            m_prep_avg = static_cast<f32>(sum) * scale / n;
+        } else {
+            auto const sum = alg::fixed::convolve_sum(m_img_pp_fx, hm, z_max, m_kern_pp_fx);
+            auto const avg = static_cast<f32>(sum) * scale / n;
 
-        alg::structure_tensor(m_img_m2_1, m_img_pp);
-        alg::convolve(m_img_m2_2, m_img_m2_1, m_kern_st);
+            alg::fixed::subtract_clamp_convert(m_frame.pp, m_img_pp_fx, quantize(avg), scale);
+
+            m_prep_avg = avg;
+        }
+
+        // local maxima are searched on m_img_pp_fx only if it is valid
+        m_pp_fx_scale.reset();
+        if (scale > 0.0f) {
+            m_pp_fx_scale = scale;
+        }
     }
 
-    // eigenvalues of structure tensor
+    return process_frame();
+}
+
+/*
+ * All stages after preprocessing, which leaves its result in m_frame.pp.
+ */
+auto TouchProcessor::process_frame() -> std::vector<TouchPoint> const&
+{
+    // regions of interest
     {
-        auto _r = m_perf_reg.record(m_perf_t_stev);
+        auto _r = m_perf_reg.record(m_perf_t_roi);
+
+        update_regions();
+    }
+
+    // local maximas
+    {
+        auto _r = m_perf_reg.record(m_perf_t_lmax);
+
+        // TODO: We may want to compute local maximas with a different smoothing factor
+
+        for (auto* r : m_regions) {
+            r->maximas.clear();
+
+            if (r == &m_frame && m_pp_fx_scale.has_value()) {
+                // same maximas on the fixed-point image, as the conversion is
+                // monotonic, with twice the SIMD width
+                auto const th = static_cast<i16>(std::floor(0.05f / *m_pp_fx_scale));
+                alg::find_local_maximas(m_img_pp_fx, th, std::back_inserter(r->maximas));
+            } else {
+                alg::find_local_maximas(r->pp, 0.05f, std::back_inserter(r->maximas));
+            }
+        }
+    }
 
-        container::ops::transform(m_img_m2_2, m_img_stev, [](auto const s) {
-            return s.eigenvalues();
+    // nothing to do if there are no local maximas, e.g. for idle frames
+    {
+        auto const idle = std::all_of(m_regions.begin(), m_regions.end(), [](auto const* r) {
+            return r->maximas.empty();
         });
+
+        m_perf_reg.sample(m_perf_c_exit_idle, idle ? 1.0 : 0.0);
+
+        if (idle) {
+            m_perf_reg.sample(m_perf_c_exit_rejected, 0.0);
+            return skip_frame();
+        }
     }
 
-    // hessian
+    // structure tensor and hessian
     {
-        auto _r = m_perf_reg.record(m_perf_t_hess);
+        auto _r = m_perf_reg.record(m_perf_t_drv);
 
-        alg::hessian(m_img_m2_1, m_img_pp);
-        alg::convolve(m_img_m2_2, m_img_m2_1, m_kern_hs);
+        for_each_tile([&](Region& r) {
+            alg::structure_tensor_hessian(r.st_1, r.hs_1, r.pp);
+            alg::convolve(r.st_2, r.st_1, m_kern_st);
+            alg::convolve(r.hs_2, r.hs_1, m_kern_hs);
+        });
+    }
+
+    // eigenvalues of structure tensor
+    {
+        auto _r = m_perf_reg.record(m_perf_t_stev);
+
+        for_each_tile([&](Region& r) {
+            alg::eigenvalues_pos_sum_coherence(r.grd, r.coh, r.st_2);
+        });
     }
 
     // ridge measure
     {
         auto _r = m_perf_reg.record(m_perf_t_rdg);
 
-        container::ops::transform(m_img_m2_2, m_img_rdg, [](auto h) {
-            auto const [ev1, ev2] = h.eigenvalues();
-            return std::max(ev1, 0.0f) + std::max(ev2, 0.0f);
+        for_each_tile([&](Region& r) {
+            alg::eigenvalues_pos_sum(r.rdg, r.hs_2);
         });
     }
 
@@ -138,143 +746,194 @@ auto TouchProcessor::process(Image<f32> const& hm) -> std::vector<TouchPoint> co
         f32 const wr = 1.5;
         f32 const wh = 1.0;
 
-        for (index_t i = 0; i < m_img_pp.size().span(); ++i) {
-            m_img_obj[i] = wh * m_img_pp[i] - wr * m_img_rdg[i];
-        }
-    }
-
-    // local maximas
-    {
-        auto _r = m_perf_reg.record(m_perf_t_lmax);
-
-        // TODO: We may want to compute local maximas with a different smoothing factor
+        for_each_tile([&](Region& r) {
+            for (index_t i = 0; i < r.pp.size().span(); ++i) {
+                r.obj[i] = wh * r.pp[i] - wr * r.rdg[i];
+            }
+        });
 
-        m_maximas.clear();
-        alg::find_local_maximas(m_img_pp, 0.05f, std::back_inserter(m_maximas));
+        // the remaining stages run on the full frame
+        if (!m_band_pool.empty()) {
+            merge_bands();
+        }
     }
 
-    // labels
-    u16 num_labels;
+    // labels and component statistics
     {
         auto _r = m_perf_reg.record(m_perf_t_lbl);
 
-        num_labels = alg::label<4>(m_img_lbl, m_img_obj, 0.0f);
-    }
+        for (auto* r : m_regions) {
+            auto& cstats = r->cstats;
+            cstats.clear();
 
-    // component score
-    {
-        auto _r = m_perf_reg.record(m_perf_t_cscr);
+            // maximas are in row-major order, same as the pixels of a component
+            auto m = r->maximas.begin();
+            auto const m_end = r->maximas.end();
 
-        m_cstats.clear();
-        m_cstats.assign(num_labels, ComponentStats { 0, 0, 0, 0 });
+            auto const new_label = [&](u16) {
+                cstats.push_back(ComponentStats { 0, 0, 0, 0 });
+            };
 
-        for (index_t i = 0; i < m_img_pp.size().span(); ++i) {
-            auto const label = m_img_lbl[i];
+            auto const add_pixel = [&](u16 label, index2_t p) {
+                auto const value = r->pp[p];
+                auto const coherence = r->coh[p];
 
-            if (label == 0)
-                continue;
+                auto& stats = cstats[label - 1];
+                stats.size += 1;
+                stats.volume += value;
+                stats.incoherence += 1.0f - (coherence * coherence);
 
-            auto const value = m_img_pp[i];
-            auto const [ev1, ev2] = m_img_stev[i];
+                auto const i = Image<f32>::ravel(r->pp.size(), p);
 
-            auto const coherence = ev1 + ev2 != 0.0f ? (ev1 - ev2) / (ev1 + ev2) : 1.0;
+                while (m != m_end && *m < i) {
+                    ++m;
+                }
 
-            m_cstats.at(label - 1).size += 1;
-            m_cstats.at(label - 1).volume += value;
-            m_cstats.at(label - 1).incoherence += 1.0f - (coherence * coherence);
-        }
+                if (m != m_end && *m == i) {
+                    stats.maximas += 1;
+                }
+            };
 
-        for (auto m : m_maximas) {
-            if (m_img_lbl[m] > 0) {
-                m_cstats.at(m_img_lbl[m] - 1).maximas += 1;
+            if (m_config.label_engine == label_engine_type::runs) {
+                r->n_labels = alg::runs::label<4>(r->lbl, r->obj, 0.0f, r->lbl_runs, new_label, add_pixel);
+            } else {
+                r->n_labels = alg::label<4>(r->lbl, r->obj, 0.0f, r->lbl_forest, new_label, add_pixel);
             }
         }
+    }
+
+    // components with a score above this are included, all others excluded
+    auto const th_inc = 0.6f;
+
+    // component score
+    {
+        auto _r = m_perf_reg.record(m_perf_t_cscr);
 
-        m_cscore.assign(num_labels, 0.0f);
-        for (index_t i = 0; i < num_labels; ++i) {
-            auto const& stats = m_cstats.at(i);
+        for (auto* r : m_regions) {
+            auto const& cstats = r->cstats;
 
-            // size score
-            auto const cen_vol = 40.0f;
-            auto const spr_vol = 15.0f;
-            auto const cov_vol =  0.9f;
+            r->cscore.assign(cstats.size(), 0.0f);
+            for (std::size_t i = 0; i < cstats.size(); ++i) {
+                auto const& stats = cstats.at(i);
 
-            auto const alph_vol = std::log(-(cov_vol + 1.0f) / (cov_vol - 1.0f)) / spr_vol;
-            auto const beta_vol = alph_vol * cen_vol;
+                // size score
+                auto const cen_vol = 40.0f;
+                auto const spr_vol = 15.0f;
+                auto const cov_vol =  0.9f;
 
-            auto const s_vol = 1.0f - 1.0f / (1.0f + std::exp(-alph_vol * stats.size + beta_vol));
+                auto const alph_vol = std::log(-(cov_vol + 1.0f) / (cov_vol - 1.0f)) / spr_vol;
+                auto const beta_vol = alph_vol * cen_vol;
 
-            // rotation score per size
-            auto const cen_rot = 0.4f;
-            auto const spr_rot = 0.3f;
-            auto const cov_rot = 0.9f;
+                auto const s_vol = 1.0f - 1.0f / (1.0f + std::exp(-alph_vol * stats.size + beta_vol));
 
-            auto const alph_rot = std::log(-(cov_rot + 1.0f) / (cov_rot - 1.0f)) / spr_rot;
-            auto const beta_rot = alph_rot * cen_rot;
+                // rotation score per size
+                auto const cen_rot = 0.4f;
+                auto const spr_rot = 0.3f;
+                auto const cov_rot = 0.9f;
 
-            auto const s_rot = 1.0f / (1.0f + std::exp(-alph_rot * (stats.incoherence / stats.size) + beta_rot));
+                auto const alph_rot = std::log(-(cov_rot + 1.0f) / (cov_rot - 1.0f)) / spr_rot;
+                auto const beta_rot = alph_rot * cen_rot;
 
-            // combined score
-            m_cscore.at(i) = stats.maximas > 0 ? s_vol * s_rot : 0.0f;
+                auto const s_rot = 1.0f / (1.0f + std::exp(-alph_rot * (stats.incoherence / stats.size) + beta_rot));
+
+                // combined score
+                r->cscore.at(i) = stats.maximas > 0 ? s_vol * s_rot : 0.0f;
+            }
         }
     }
 
-    // TODO: limit inclusion to N (e.g. N=16) local maximas by highest inclusion score
-    // TODO: if everything is excluded here, we can skip the rest
-    //       (useful to improve performance for touch sensor issues)
+    // if all components are excluded (e.g. palms or sensor noise), the filter
+    // removes everything and there is nothing left to fit
+    {
+        auto const rejected = std::all_of(m_regions.begin(), m_regions.end(), [&](auto const* r) {
+            return std::all_of(r->cscore.begin(), r->cscore.end(), [&](f32 s) {
+                return s <= th_inc;
+            });
+        });
+
+        m_perf_reg.sample(m_perf_c_exit_rejected, rejected ? 1.0 : 0.0);
+
+        if (rejected)
+            return skip_frame();
+    }
 
     // distance transform
     {
         auto _r = m_perf_reg.record(m_perf_t_wdt);
 
-        auto const th_inc = 0.6f;
+        for (auto* r : m_regions) {
+            auto const wdt_cost = [&](index_t i, index2_t d) -> f32 {
+                f32 const c_dist = 0.1f;
+                f32 const c_ridge = 9.0f;
+                f32 const c_grad = 1.0f;
 
-        auto const wdt_cost = [&](index_t i, index2_t d) -> f32 {
-            f32 const c_dist = 0.1f;
-            f32 const c_ridge = 9.0f;
-            f32 const c_grad = 1.0f;
+                auto const grad = r->grd[i];
+                auto const ridge = r->rdg[i];
+                auto const dist = std::sqrt(static_cast<f32>(d.x * d.x + d.y * d.y));
 
-            auto const [ev1, ev2] = m_img_stev[i];
-            auto const grad = std::max(ev1, 0.0f) + std::max(ev2, 0.0f);
-            auto const ridge = m_img_rdg[i];
-            auto const dist = std::sqrt(static_cast<f32>(d.x * d.x + d.y * d.y));
+                return c_ridge * ridge + c_grad * grad + c_dist * dist;
+            };
 
-            return c_ridge * ridge + c_grad * grad + c_dist * dist;
-        };
+            auto const wdt_mask = [&](index_t i) -> bool {
+                return r->pp[i] > 0.0f && r->lbl[i] == 0;
+            };
 
-        auto const wdt_mask = [&](index_t i) -> bool {
-            return m_img_pp[i] > 0.0f && m_img_lbl[i] == 0;
-        };
+            auto const wdt_inc_bin = [&](index_t i) -> bool {
+                return r->lbl[i] > 0 && r->cscore.at(r->lbl[i] - 1) > th_inc;
+            };
 
-        auto const wdt_inc_bin = [&](index_t i) -> bool {
-            return m_img_lbl[i] > 0 && m_cscore.at(m_img_lbl[i] - 1) > th_inc;
-        };
+            auto const wdt_exc_bin = [&](index_t i) -> bool {
+                return r->lbl[i] > 0 && r->cscore.at(r->lbl[i] - 1) <= th_inc;
+            };
 
-        auto const wdt_exc_bin = [&](index_t i) -> bool {
-            return m_img_lbl[i] > 0 && m_cscore.at(m_img_lbl[i] - 1) <= th_inc;
-        };
+            auto const wdt = [&](auto& queue) {
+                alg::weighted_distance_transform_dual<4>(r->dm1, r->dm2, wdt_inc_bin, wdt_exc_bin,
+                                                         wdt_mask, wdt_cost, queue, 6.0f);
+            };
+
+            switch (m_config.wdt_queue) {
+            case wdt_queue_type::binary_heap:
+                wdt(m_wdt_queue);
+                break;
 
-        alg::weighted_distance_transform<4>(m_img_dm1, wdt_inc_bin, wdt_mask, wdt_cost, m_wdt_queue, 6.0f);
-        alg::weighted_distance_transform<4>(m_img_dm2, wdt_exc_bin, wdt_mask, wdt_cost, m_wdt_queue, 6.0f);
+            case wdt_queue_type::radix_heap:
+                wdt(m_wdt_rqueue);
+                break;
+            }
+        }
     }
 
     // filter
     {
         auto _r = m_perf_reg.record(m_perf_t_flt);
 
-        for (index_t i = 0; i < m_img_pp.size().span(); ++i) {
-            auto const sigma = 1.0f;
+        // rows [y0, y1] of a region
+        auto const filter = [&](Region const& r, index_t y0, index_t y1) {
+            for (index_t i = y0 * r.size().x; i < (y1 + 1) * r.size().x; ++i) {
+                auto const sigma = 1.0f;
+                auto const p = Image<f32>::unravel(r.pp.size(), i) + r.offset;
 
-            auto w_inc = m_img_dm1[i] / sigma;
-            w_inc = std::exp(-w_inc * w_inc);
+                auto w_inc = r.dm1[i] / sigma;
+                w_inc = std::exp(-w_inc * w_inc);
 
-            auto w_exc = m_img_dm2[i] / sigma;
-            w_exc = std::exp(-w_exc * w_exc);
+                auto w_exc = r.dm2[i] / sigma;
+                w_exc = std::exp(-w_exc * w_exc);
 
-            auto const w_total = w_inc + w_exc;
-            auto const w = w_total > 0.0f ? w_inc / w_total : 0.0f;
+                auto const w_total = w_inc + w_exc;
+                auto const w = w_total > 0.0f ? w_inc / w_total : 0.0f;
+
+                m_img_flt[p] = r.pp[i] * w;
+            }
+        };
 
-            m_img_flt[i] = m_img_pp[i] * w;
+        if (m_band_pool.empty()) {
+            for_each_tile([&](Region& r) {
+                filter(r, 0, r.size().y - 1);
+            });
+        } else {
+            parallel_for(m_band_bounds.size(), [&](std::size_t i) {
+                filter(m_frame, m_band_bounds[i].ymin, m_band_bounds[i].ymax);
+            });
         }
     }
 
@@ -286,71 +945,17 @@ auto TouchProcessor::process(Image<f32> const& hm) -> std::vector<TouchPoint> co
 
         m_maximas.clear();
         alg::find_local_maximas(m_img_flt, 0.05f, std::back_inserter(m_maximas));
+
+        limit_contacts();
     }
 
     // gaussian fitting
-    if (!m_maximas.empty()) {
-        auto _r = m_perf_reg.record(m_perf_t_gfit);
-
-        alg::gfit::reserve(m_gf_params, m_maximas.size(), m_gf_window);
-
-        for (std::size_t i = 0; i < m_maximas.size(); ++i) {
-            auto const [x, y] = Image<f32>::unravel(m_img_pp.size(), m_maximas[i]);
-
-            // TODO: move window inwards instead of clamping?
-            auto const bounds = alg::gfit::BBox {
-                std::max(x - (m_gf_window.x - 1) / 2, 0),
-                std::min(x + (m_gf_window.x - 1) / 2, m_img_pp.size().x - 1),
-                std::max(y - (m_gf_window.y - 1) / 2, 0),
-                std::min(y + (m_gf_window.y - 1) / 2, m_img_pp.size().y - 1),
-            };
-
-            m_gf_params[i].valid  = true;
-            m_gf_params[i].scale  = 1.0f;
-            m_gf_params[i].mean   = { static_cast<f32>(x), static_cast<f32>(y) };
-            m_gf_params[i].prec   = { 1.0f, 0.0f, 1.0f };
-            m_gf_params[i].bounds = bounds;
-        }
-
-        alg::gfit::fit(m_gf_params, m_img_flt, m_img_gftmp, 3);
+    if (m_config.gfit_precision == gfit_precision_type::f32) {
+        fit_contacts(m_gf_params_f32, m_img_gftmp_f32);
+        generate_output(m_gf_params_f32);
     } else {
-        for (auto& p : m_gf_params) {
-            p.valid = false;
-        }
-    }
-
-    // generate output
-    m_touchpoints.clear();
-    for (auto const& p : m_gf_params) {
-        if (!p.valid) {
-            continue;
-        }
-
-        auto const cov = p.prec.inverse();
-        if (!cov.has_value()) {
-            spdlog::warn("failed to invert matrix");
-            continue;
-        }
-
-        auto const [ev1, ev2] = cov->eigenvalues();
-        auto const sd1 = std::sqrt(std::abs(ev1));
-        auto const sd2 = std::sqrt(std::abs(ev2));
-
-        if (sd1 <= math::num<f32>::eps || sd2 <= math::num<f32>::eps) {
-            spdlog::warn("standard deviation too small");
-            continue;
-        }
-
-        auto const aspect = std::max(sd1, sd2) / std::min(sd1, sd2);
-        if (aspect > 2.0f) {
-            continue;
-        }
-
-        auto const x = std::clamp(static_cast<index_t>(p.mean.x), 0, m_img_lbl.size().x - 1);
-        auto const y = std::clamp(static_cast<index_t>(p.mean.y), 0, m_img_lbl.size().y - 1);
-        auto const cs = m_img_lbl[{ x, y }] > 0 ? m_cscore.at(m_img_lbl[{ x, y }] - 1) : 0.0f;
-
-        m_touchpoints.push_back(TouchPoint { cs, static_cast<f32>(p.scale), p.mean.cast<f32>(), cov->cast<f32>() });
+        fit_contacts(m_gf_params_f64, m_img_gftmp_f64);
+        generate_output(m_gf_params_f64);
     }
 
     return m_touchpoints;
@@ -4,16 +4,24 @@
 
 #include "algorithm/distance_transform.hpp"
 #include "algorithm/gaussian_fitting.hpp"
+#include "algorithm/label_runs.hpp"
+#include "algorithm/preprocessing_fixed.hpp"
+#include "algorithm/region_of_interest.hpp"
 
 #include "container/image.hpp"
 #include "container/kernel.hpp"
+#include "container/tensor_image.hpp"
 
 #include "eval/perf.hpp"
 
 #include "math/vec2.hpp"
 #include "math/mat2.hpp"
 
+#include "utils/thread_pool.hpp"
+
 #include <array>
+#include <functional>
+#include <optional>
 #include <vector>
 #include <queue>
 
@@ -28,6 +36,87 @@ struct TouchPoint {
 };
 
 
+enum class wdt_queue_type {
+    binary_heap,
+    radix_heap,
+};
+
+
+/*
+ * Mean subtracted from the heatmap during preprocessing. Using the mean of
+ * the previous frame allows fusing the subtraction into the convolution
+ * sweep, in both the float and fixed-point paths. The first frame always
+ * uses its own mean.
+ */
+enum class prep_mean_type {
+    current,
+    previous,
+};
+
+
+/*
+ * Connected component labeling via union-find over single pixels, or over
+ * runs of pixels in each row. Both yield the same labels.
+ */
+enum class label_engine_type {
+    pixels,
+    runs,
+};
+
+
+/*
+ * Floating point type used for gaussian fitting.
+ */
+enum class gfit_precision_type {
+    f32,
+    f64,
+};
+
+
+struct TouchProcessorConfig {
+    wdt_queue_type wdt_queue = wdt_queue_type::radix_heap;
+    prep_mean_type prep_mean = prep_mean_type::current;
+
+    // run the dense stages from the derivatives up to the filter only on
+    // regions around active pixels, instead of the full frame
+    bool roi = false;
+
+    label_engine_type label_engine = label_engine_type::runs;
+
+    // maximum number of contacts to fit per frame, should be set to the
+    // max_contacts value reported by the device (see ipts_device_info)
+    index_t max_contacts = 16;
+
+    // single precision doubles the SIMD width of the fitting loops
+    gfit_precision_type gfit_precision = gfit_precision_type::f64;
+
+    // seed gaussian fitting with the parameters of the closest contact of
+    // the previous frame, instead of a unit gaussian at the maximum; off by
+    // default, as contacts then converge to slightly different parameters
+    bool gfit_warm_start = false;
+
+    // seed gaussian fitting with the quadratic sub-pixel peak around each
+    // maximum, instead of the center of the maximum pixel
+    bool gfit_subpixel_start = false;
+
+    // stop fitting a contact once its mean moves by at most this many pixels
+    // (and its precision by at most this fraction) per iteration, zero to
+    // always run all iterations; the default leaves the reported contacts
+    // unchanged while skipping about a quarter of the iterations
+    f32 gfit_tolerance = 1e-4f;
+
+    // number of threads, including the calling one, across which contacts
+    // are fitted and regions or bands are processed in parallel, at most the
+    // number of hardware threads; one disables the worker pool
+    index_t threads = 1;
+
+    // full frame only: split the dense stages from the derivatives up to the
+    // objective, and the filter, into this many row bands, which are run in
+    // parallel on the worker pool, one disables banding
+    index_t bands = 1;
+};
+
+
 struct ComponentStats {
     u32 size;
     f32 volume;
@@ -38,19 +127,25 @@ struct ComponentStats {
 
 class TouchProcessor {
 public:
-    TouchProcessor(index2_t size);
+    TouchProcessor(index2_t size, TouchProcessorConfig const& config={});
 
     auto process(Image<f32> const& hm) -> std::vector<TouchPoint> const&;
+
+    // raw heatmap samples, preprocessed in fixed point (see preprocessing_fixed.hpp)
+    auto process(Image<u8> const& hm, u8 z_min, u8 z_max) -> std::vector<TouchPoint> const&;
+
     auto perf() const -> eval::perf::Registry const&;
 
 private:
+    // configuration
+    TouchProcessorConfig m_config;
+
     // performance measurements
     eval::perf::Registry m_perf_reg;
     eval::perf::Token m_perf_t_total;
     eval::perf::Token m_perf_t_prep;
-    eval::perf::Token m_perf_t_st;
     eval::perf::Token m_perf_t_stev;
-    eval::perf::Token m_perf_t_hess;
+    eval::perf::Token m_perf_t_drv;
     eval::perf::Token m_perf_t_rdg;
     eval::perf::Token m_perf_t_obj;
     eval::perf::Token m_perf_t_lmax;
@@ -60,34 +155,142 @@ private:
     eval::perf::Token m_perf_t_flt;
     eval::perf::Token m_perf_t_lmaxf;
     eval::perf::Token m_perf_t_gfit;
+    eval::perf::Token m_perf_t_roi;
+    eval::perf::CounterToken m_perf_c_roi_skip;
+    eval::perf::CounterToken m_perf_c_exit_idle;
+    eval::perf::CounterToken m_perf_c_exit_rejected;
+    eval::perf::CounterToken m_perf_c_gfit_iter;
+
+    /*
+     * Storage for the stages from the derivatives up to the filter, of
+     * either the full frame, a single region of interest, or a row band.
+     * Bands only run the dense stages up to the objective, which is merged
+     * into the full frame, so their label and distance buffers stay empty,
+     * as does the union-find forest unless the pixel labeling is selected.
+     */
+    struct Region {
+        enum class role_type {
+            full,       // all stages
+            dense,      // dense stages up to the objective only (bands)
+        };
+
+        Region(index2_t size, TouchProcessorConfig const& config, role_type role = role_type::full);
+
+        auto size() const -> index2_t;
+        void resize(index2_t size);
+
+        index2_t offset;
+
+        // buffers selected by the configuration and role
+        label_engine_type label_engine;
+        role_type role;
+
+        Image<f32> pp;
+        TensorImage<f32> st_1;
+        TensorImage<f32> st_2;
+        TensorImage<f32> hs_1;
+        TensorImage<f32> hs_2;
+        Image<f32> grd;
+        Image<f32> coh;
+        Image<f32> rdg;
+        Image<f32> obj;
+        Image<u16> lbl;
+        Image<u16> lbl_forest;
+        alg::runs::Storage lbl_runs;
+        Image<f32> dm1;
+        Image<f32> dm2;
+
+        u16 n_labels;
+        std::vector<index_t> maximas;
+        std::vector<ComponentStats> cstats;
+        std::vector<f32> cscore;
+    };
+
+    auto process_frame() -> std::vector<TouchPoint> const&;
+
+    auto margin() const -> index_t;
+    void update_regions();
+    void merge_bands();
+
+    template<class F>
+    void for_each_tile(F fn);
+
+    template<class F>
+    void parallel_for(std::size_t n, F fn);
+
+    /*
+     * Candidate contact, ranked by component score and value.
+     */
+    struct Contact {
+        f32 score;
+        f32 value;
+        index_t index;
+    };
+
+    auto find_region(index2_t p) const -> Region const*;
+    auto component_score(index2_t p) const -> f32;
+    void limit_contacts();
+    auto skip_frame() -> std::vector<TouchPoint> const&;
+
+    /*
+     * Contact fitted in the previous frame, used for warm starting.
+     */
+    struct PrevFit {
+        f64 scale;
+        Vec2<f64> mean;
+        Mat2s<f64> prec;
+        bool used;
+    };
+
+    template<class S>
+    void fit_contacts(std::vector<alg::gfit::Parameters<S>>& params, Image<S>& tmp);
+
+    template<class S>
+    void generate_output(std::vector<alg::gfit::Parameters<S>> const& params);
 
     // temporary storage
-    Image<f32> m_img_pp;
-    Image<Mat2s<f32>> m_img_m2_1;
-    Image<Mat2s<f32>> m_img_m2_2;
-    Image<std::array<f32, 2>> m_img_stev;
-    Image<f32> m_img_rdg;
-    Image<f32> m_img_obj;
-    Image<u16> m_img_lbl;
-    Image<f32> m_img_dm1;
-    Image<f32> m_img_dm2;
+    Region m_frame;
+    std::vector<Region> m_roi_pool;
+    std::vector<Region*> m_regions;
+    std::vector<alg::roi::BBox> m_roi_bounds;
+    std::vector<alg::roi::BBox> m_roi_bounds_prev;
+    std::vector<Region> m_band_pool;
+    std::vector<alg::roi::BBox> m_band_bounds;
+    std::vector<Region*> m_tiles;
+
+    Image<i16> m_img_pp_fx;
     Image<f32> m_img_flt;
-    Image<f64> m_img_gftmp;
+    Image<f32> m_img_gftmp_f32;
+    Image<f64> m_img_gftmp_f64;
 
-    std::priority_queue<alg::wdt::QItem<f32>> m_wdt_queue;
-    std::vector<alg::gfit::Parameters<f64>> m_gf_params;
+    std::priority_queue<alg::wdt::QItem<f32>, std::vector<alg::wdt::QItem<f32>>,
+                        std::greater<alg::wdt::QItem<f32>>> m_wdt_queue;
+    alg::wdt::RadixQueue<f32> m_wdt_rqueue;
+    std::vector<alg::gfit::Parameters<f32>> m_gf_params_f32;
+    std::vector<alg::gfit::Parameters<f64>> m_gf_params_f64;
 
     std::vector<index_t> m_maximas;
-    std::vector<ComponentStats> m_cstats;
-    std::vector<f32> m_cscore;
+    std::vector<Contact> m_contacts;
+
+    // worker threads
+    std::optional<utils::ThreadPool> m_pool;
 
     // gauss kernels
-    Kernel<f32, 5, 5> m_kern_pp;
-    Kernel<f32, 5, 5> m_kern_st;
-    Kernel<f32, 5, 5> m_kern_hs;
+    SeparableKernel<f32, 5, 5> m_kern_pp;
+    SeparableKernel<f32, 5, 5> m_kern_st;
+    SeparableKernel<f32, 5, 5> m_kern_hs;
+    SeparableKernel<i16, 5, 5> m_kern_pp_fx;
 
     // parameters
-    index2_t m_gf_window;
+    f32 m_gf_warm_dist;
+
+    // state carried over between frames
+    std::optional<f32> m_prep_avg;
+    std::vector<PrevFit> m_gf_prev;
+
+    // scale of m_img_pp_fx if the current frame has been preprocessed in
+    // fixed point
+    std::optional<f32> m_pp_fx_scale;
 
     // output
     std::vector<TouchPoint> m_touchpoints;
@@ -99,4 +302,9 @@ inline auto TouchProcessor::perf() const -> eval::perf::Registry const&
     return m_perf_reg;
 }
 
+inline auto TouchProcessor::Region::size() const -> index2_t
+{
+    return pp.size();
+}
+
 } /* namespace iptsd */
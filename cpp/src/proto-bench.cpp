@@ -0,0 +1,1718 @@
+#include "processor.hpp"
+#include "parser.hpp"
+#include "heatmap_decoder.hpp"
+#include "types.hpp"
+
+#include "algorithm/convolution.hpp"
+#include "algorithm/eigenvalues.hpp"
+#include "algorithm/gaussian_fitting.hpp"
+#include "algorithm/hessian.hpp"
+#include "algorithm/label.hpp"
+#include "algorithm/label_runs.hpp"
+#include "algorithm/local_maxima.hpp"
+#include "algorithm/preprocessing.hpp"
+#include "algorithm/preprocessing_fixed.hpp"
+#include "algorithm/structure_tensor.hpp"
+#include "algorithm/structure_tensor_hessian.hpp"
+
+#include "container/image.hpp"
+#include "container/kernel.hpp"
+#include "container/ops.hpp"
+#include "container/tensor_image.hpp"
+
+#include "eval/perf.hpp"
+
+#include "math/exp.hpp"
+#include "math/mat2.hpp"
+#include "math/mat6.hpp"
+#include "math/sle6.hpp"
+#include "math/vec6.hpp"
+
+#include <CLI/CLI.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace iptsd;
+
+
+auto read_file(char const* path) -> std::vector<u8>
+{
+    std::ifstream ifs;
+    ifs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    ifs.open(path, std::ios::binary | std::ios::ate);
+
+    std::streamsize size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+
+    std::vector<u8> buffer(size);
+    ifs.read(reinterpret_cast<char*>(buffer.data()), size);
+
+    return buffer;
+}
+
+
+/*
+ * Raw heatmap samples with their range.
+ */
+struct RawHeatmap {
+    Image<u8> data;
+    u8 z_min;
+    u8 z_max;
+};
+
+
+class Parser : public ParserBase {
+private:
+    std::vector<Image<f32>> m_data;
+    std::vector<RawHeatmap> m_raw;
+    HeatmapDecoder m_decoder;
+
+public:
+    auto parse(char const* file) -> std::vector<Image<f32>>;
+    auto parse_raw(char const* file) -> std::vector<RawHeatmap>;
+
+protected:
+    virtual void on_heatmap_dim(IptsHeatmapDim const& dim);
+    virtual void on_heatmap(gsl::span<const std::byte> const& data);
+};
+
+auto Parser::parse(char const* file) -> std::vector<Image<f32>>
+{
+    m_data = std::vector<Image<f32>>{};
+
+    auto const data = read_file(file);
+    this->do_parse(gsl::as_bytes(gsl::span{data}));
+
+    return std::move(m_data);
+}
+
+auto Parser::parse_raw(char const* file) -> std::vector<RawHeatmap>
+{
+    m_raw = std::vector<RawHeatmap>{};
+
+    auto const data = read_file(file);
+    this->do_parse(gsl::as_bytes(gsl::span{data}));
+
+    return std::move(m_raw);
+}
+
+void Parser::on_heatmap_dim(IptsHeatmapDim const& dim)
+{
+    m_decoder.set_dim(dim);
+}
+
+void Parser::on_heatmap(gsl::span<const std::byte> const& data)
+{
+    auto const& dim = m_decoder.dim();
+
+    auto img = Image<f32> { m_decoder.size() };
+    m_decoder.decode(img, data);
+
+    m_data.push_back(img);
+
+    auto raw = Image<u8> { m_decoder.size() };
+    m_decoder.decode(raw, data);
+
+    m_raw.push_back(RawHeatmap { raw, dim.z_min, dim.z_max });
+}
+
+
+auto load_heatmaps(std::vector<std::string> const& paths) -> std::vector<Image<f32>>
+{
+    auto heatmaps = std::vector<Image<f32>>{};
+
+    for (auto const& path : paths) {
+        auto data = Parser().parse(path.c_str());
+
+        spdlog::info("Loaded {} heatmaps from '{}'", data.size(), path);
+
+        heatmaps.insert(heatmaps.end(), std::make_move_iterator(data.begin()),
+                        std::make_move_iterator(data.end()));
+    }
+
+    return heatmaps;
+}
+
+auto load_raw_heatmaps(std::vector<std::string> const& paths) -> std::vector<RawHeatmap>
+{
+    auto heatmaps = std::vector<RawHeatmap>{};
+
+    for (auto const& path : paths) {
+        auto data = Parser().parse_raw(path.c_str());
+
+        heatmaps.insert(heatmaps.end(), std::make_move_iterator(data.begin()),
+                        std::make_move_iterator(data.end()));
+    }
+
+    return heatmaps;
+}
+
+
+void print_entry(std::string const& label, eval::perf::Entry const& e)
+{
+    using us = std::chrono::microseconds;
+    using ns = std::chrono::nanoseconds;
+
+    spdlog::info("  {} [{}]", e.name, label);
+    spdlog::info("    N:           {:8d}", e.n_measurements);
+    spdlog::info("    full (us):   {:8d}", e.total<us>().count());
+    spdlog::info("    mean (ns):   {:8d}", e.mean<ns>().count());
+    spdlog::info("    stddev (ns): {:8d}", e.stddev<ns>().count());
+    spdlog::info("    min (ns):    {:8d}", e.min<ns>().count());
+    spdlog::info("    max (ns):    {:8d}", e.max<ns>().count());
+    spdlog::info("");
+}
+
+void print_counter(std::string const& label, eval::perf::Counter const& c)
+{
+    spdlog::info("  {} [{}]", c.name, label);
+    spdlog::info("    N:           {:8d}", c.n_samples);
+    spdlog::info("    mean:        {:8.4f}", c.mean());
+    spdlog::info("    stddev:      {:8.4f}", c.stddev());
+    spdlog::info("    min:         {:8.4f}", c.minimum);
+    spdlog::info("    max:         {:8.4f}", c.maximum);
+    spdlog::info("");
+}
+
+auto find_entry(eval::perf::Registry const& reg, std::string const& name) -> eval::perf::Entry const*
+{
+    auto const& entries = reg.entries();
+
+    auto const e = std::find_if(entries.begin(), entries.end(), [&](auto const& e) {
+        return e.name == name;
+    });
+
+    if (e == entries.end()) {
+        spdlog::warn("unknown stage '{}'", name);
+        return nullptr;
+    }
+
+    return &*e;
+}
+
+
+template<class T>
+auto max_abs_diff(Image<T> const& a, Image<T> const& b) -> f32
+{
+    auto const flat = [](auto const& img) {
+        return gsl::span { reinterpret_cast<f32 const*>(img.data()), img.size().span() * sizeof(T) / sizeof(f32) };
+    };
+
+    auto const fa = flat(a);
+    auto const fb = flat(b);
+
+    f32 d = 0.0f;
+    for (std::size_t i = 0; i < fa.size(); ++i) {
+        d = std::max(d, std::abs(fa[i] - fb[i]));
+    }
+
+    return d;
+}
+
+
+/*
+ * Run the full processor over all heatmaps for each configuration and compare
+ * the timings recorded for the given stages.
+ */
+void bench_processor(std::vector<Image<f32>> const& heatmaps, int n_iter,
+                     std::vector<std::pair<std::string, TouchProcessorConfig>> const& configs,
+                     std::vector<std::string> const& stages)
+{
+    auto results = std::vector<eval::perf::Registry>{};
+
+    for (auto const& [label, config] : configs) {
+        auto proc = TouchProcessor { heatmaps[0].size(), config };
+
+        for (int i = 0; i < n_iter; ++i) {
+            for (auto const& hm : heatmaps) {
+                proc.process(hm);
+            }
+        }
+
+        results.push_back(proc.perf());
+    }
+
+    spdlog::info("Performance Statistics:");
+
+    for (auto const& stage : stages) {
+        for (std::size_t i = 0; i < configs.size(); ++i) {
+            auto const* e = find_entry(results[i], stage);
+
+            // stage unknown or not run with this configuration
+            if (!e || e->n_measurements == 0)
+                continue;
+
+            print_entry(configs[i].first, *e);
+        }
+    }
+
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+        for (auto const& c : results[i].counters()) {
+            if (c.n_samples == 0)
+                continue;
+
+            print_counter(configs[i].first, c);
+        }
+    }
+}
+
+
+/*
+ * Accumulated differences between the contacts of two configurations.
+ */
+struct ContactDiff {
+    std::size_t n_frames = 0;
+    std::size_t n_contacts = 0;
+    std::size_t n_mismatch = 0;
+
+    f32 d_mean_max = 0.0f;
+    f64 d_mean_sum = 0.0;
+    f32 d_cov_max = 0.0f;
+    f32 r_cov_max = 0.0f;
+    std::size_t f_cov_max = 0;
+
+    void add(std::vector<TouchPoint> const& tp_a, std::vector<TouchPoint> const& tp_b);
+    void print(std::string const& name_a, std::string const& name_b) const;
+};
+
+/*
+ * Add the contacts of one frame, frames with a differing number of contacts
+ * are skipped.
+ */
+void ContactDiff::add(std::vector<TouchPoint> const& tp_a, std::vector<TouchPoint> const& tp_b)
+{
+    n_frames += 1;
+
+    // contacts rejected in only one of the configurations
+    if (tp_a.size() != tp_b.size()) {
+        n_mismatch += 1;
+        return;
+    }
+
+    for (std::size_t i = 0; i < tp_b.size(); ++i) {
+        auto const& a = tp_a[i];
+        auto const& b = tp_b[i];
+
+        auto const d_mean = std::hypot(a.mean.x - b.mean.x, a.mean.y - b.mean.y);
+
+        d_mean_max = std::max(d_mean_max, d_mean);
+        d_mean_sum += d_mean;
+
+        auto const ca = std::array<f32, 3> { a.cov.xx, a.cov.xy, a.cov.yy };
+        auto const cb = std::array<f32, 3> { b.cov.xx, b.cov.xy, b.cov.yy };
+        auto const norm = std::max(std::abs(b.cov.xx), std::abs(b.cov.yy));
+
+        for (std::size_t k = 0; k < 3; ++k) {
+            auto const d = std::abs(ca[k] - cb[k]);
+
+            if (d / norm > r_cov_max) {
+                r_cov_max = d / norm;
+                f_cov_max = n_frames - 1;
+            }
+
+            d_cov_max = std::max(d_cov_max, d);
+        }
+    }
+
+    n_contacts += tp_b.size();
+}
+
+void ContactDiff::print(std::string const& name_a, std::string const& name_b) const
+{
+    spdlog::info("Accuracy ({} vs. {}):", name_a, name_b);
+    spdlog::info("  frames:                      {:8d}", n_frames);
+    spdlog::info("  contacts:                    {:8d}", n_contacts);
+    spdlog::info("  frames with differing count: {:8d}", n_mismatch);
+    spdlog::info("  mean, max. distance (px):    {:e}", d_mean_max);
+    spdlog::info("  mean, avg. distance (px):    {:e}", n_contacts > 0 ? d_mean_sum / n_contacts : 0.0);
+    spdlog::info("  cov., max. abs. difference:  {:e}", d_cov_max);
+    spdlog::info("  cov., max. rel. difference:  {:e}", r_cov_max);
+    spdlog::info("  cov., max. rel. diff. frame: {:8d}", f_cov_max);
+    spdlog::info("");
+}
+
+/*
+ * Run two configurations side by side and compare the fitted contacts.
+ */
+void compare_contacts(std::vector<Image<f32>> const& heatmaps,
+                      std::pair<std::string, TouchProcessorConfig> const& cfg_a,
+                      std::pair<std::string, TouchProcessorConfig> const& cfg_b)
+{
+    auto proc_a = TouchProcessor { heatmaps[0].size(), cfg_a.second };
+    auto proc_b = TouchProcessor { heatmaps[0].size(), cfg_b.second };
+
+    auto diff = ContactDiff{};
+
+    for (auto const& hm : heatmaps) {
+        diff.add(proc_a.process(hm), proc_b.process(hm));
+    }
+
+    diff.print(cfg_a.first, cfg_b.first);
+}
+
+
+void bench_wdt(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto cfg_bin = TouchProcessorConfig{};
+    cfg_bin.wdt_queue = wdt_queue_type::binary_heap;
+
+    auto cfg_rdx = TouchProcessorConfig{};
+    cfg_rdx.wdt_queue = wdt_queue_type::radix_heap;
+
+    compare_contacts(heatmaps, { "radix-heap", cfg_rdx }, { "binary-heap", cfg_bin });
+
+    bench_processor(heatmaps, n_iter, {
+        { "binary-heap", cfg_bin },
+        { "radix-heap",  cfg_rdx },
+    }, {
+        "distance-transform",
+    });
+}
+
+
+void bench_prep(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto cfg_cur = TouchProcessorConfig{};
+    cfg_cur.prep_mean = prep_mean_type::current;
+
+    auto cfg_prev = TouchProcessorConfig{};
+    cfg_prev.prep_mean = prep_mean_type::previous;
+
+    bench_processor(heatmaps, n_iter, {
+        { "current-mean",  cfg_cur  },
+        { "previous-mean", cfg_prev },
+    }, {
+        "preprocessing",
+    });
+}
+
+
+/*
+ * Compare the derivative stages, from the preprocessed heatmap up to the
+ * gradient, coherence and ridge images: structure tensor and hessian computed
+ * and smoothed separately or fused on interleaved images, and fused on the
+ * planar images used by the processor.
+ */
+void bench_deriv(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    struct Output {
+        Image<f32> grd;
+        Image<f32> coh;
+        Image<f32> rdg;
+    };
+
+    auto const size = heatmaps[0].size();
+    auto const n = static_cast<f32>(size.span());
+
+    auto const kern_pp = alg::conv::kernels::gaussian_separable<f32, 5, 5>(0.9f);
+    auto const kern = alg::conv::kernels::gaussian_separable<f32, 5, 5>(1.0f);
+
+    auto pp = Image<f32> { size };
+    auto m2_1 = Image<Mat2s<f32>> { size };
+    auto m2_2 = Image<Mat2s<f32>> { size };
+    auto m2x2_1 = Image<std::array<Mat2s<f32>, 2>> { size };
+    auto m2x2_2 = Image<std::array<Mat2s<f32>, 2>> { size };
+    auto st_1 = TensorImage<f32> { size };
+    auto st_2 = TensorImage<f32> { size };
+    auto hs_1 = TensorImage<f32> { size };
+    auto hs_2 = TensorImage<f32> { size };
+
+    auto out = std::array<Output, 3>{};
+    for (auto& o : out) {
+        o = { Image<f32> { size }, Image<f32> { size }, Image<f32> { size } };
+    }
+
+    auto reg = eval::perf::Registry{};
+    auto const t_sep = reg.create_entry("structure-tensor+hessian");
+    auto const t_fus = reg.create_entry("structure-tensor+hessian");
+    auto const t_pln = reg.create_entry("structure-tensor+hessian");
+
+    auto d_max = 0.0f;
+
+    for (auto const& hm : heatmaps) {
+        auto const avg = alg::convolve_sum(pp, hm, kern_pp) / n;
+        alg::subtract_clamp(pp, avg);
+
+        for (int i = 0; i < n_iter; ++i) {
+            {
+                auto _r = reg.record(t_sep);
+
+                alg::structure_tensor(m2_1, pp);
+                alg::convolve(m2_2, m2_1, kern);
+                alg::eigenvalues_pos_sum_coherence(out[0].grd, out[0].coh, m2_2);
+
+                alg::hessian(m2_1, pp);
+                alg::convolve(m2_2, m2_1, kern);
+                alg::eigenvalues_pos_sum(out[0].rdg, m2_2);
+            }
+
+            {
+                auto _r = reg.record(t_fus);
+
+                alg::structure_tensor_hessian(m2x2_1, pp);
+                alg::convolve(m2x2_2, m2x2_1, kern);
+                alg::eigenvalues_pos_sum_coherence<0>(out[1].grd, out[1].coh, m2x2_2);
+                alg::eigenvalues_pos_sum<1>(out[1].rdg, m2x2_2);
+            }
+
+            {
+                auto _r = reg.record(t_pln);
+
+                alg::structure_tensor_hessian(st_1, hs_1, pp);
+                alg::convolve(st_2, st_1, kern);
+                alg::convolve(hs_2, hs_1, kern);
+                alg::eigenvalues_pos_sum_coherence(out[2].grd, out[2].coh, st_2);
+                alg::eigenvalues_pos_sum(out[2].rdg, hs_2);
+            }
+        }
+
+        for (auto const* o : { &out[1], &out[2] }) {
+            d_max = std::max({ d_max, max_abs_diff(out[0].grd, o->grd), max_abs_diff(out[0].coh, o->coh),
+                               max_abs_diff(out[0].rdg, o->rdg) });
+        }
+    }
+
+    auto const& e_sep = reg.get_entry(t_sep);
+    auto const& e_fus = reg.get_entry(t_fus);
+    auto const& e_pln = reg.get_entry(t_pln);
+
+    spdlog::info("Performance Statistics (up to gradient, coherence and ridge):");
+    print_entry("interleaved, separate", e_sep);
+    print_entry("interleaved, fused", e_fus);
+    print_entry("planar", e_pln);
+    spdlog::info("  speedup (fused / planar): {:.2f}x / {:.2f}x", e_sep.r_mean_ns / e_fus.r_mean_ns,
+                 e_sep.r_mean_ns / e_pln.r_mean_ns);
+    spdlog::info("  max. abs. difference:     {:e}", d_max);
+}
+
+
+void bench_roi(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto cfg_full = TouchProcessorConfig{};
+    cfg_full.roi = false;
+
+    auto cfg_roi = TouchProcessorConfig{};
+    cfg_roi.roi = true;
+
+    compare_contacts(heatmaps, { "roi", cfg_roi }, { "full", cfg_full });
+
+    bench_processor(heatmaps, n_iter, {
+        { "full-frame", cfg_full },
+        { "roi",        cfg_roi  },
+    }, {
+        "roi",
+        "structure-tensor+hessian",
+        "structure-tensor.eigenvalues",
+        "ridge",
+        "objective",
+        "labels",
+        "component-score",
+        "distance-transform",
+        "filter",
+        "total",
+    });
+}
+
+
+/*
+ * Compare the contacts fitted in single and double precision, then time both.
+ */
+void bench_precision(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto cfg_f32 = TouchProcessorConfig{};
+    cfg_f32.gfit_precision = gfit_precision_type::f32;
+
+    auto cfg_f64 = TouchProcessorConfig{};
+    cfg_f64.gfit_precision = gfit_precision_type::f64;
+
+    compare_contacts(heatmaps, { "f32", cfg_f32 }, { "f64", cfg_f64 });
+
+    bench_processor(heatmaps, n_iter, {
+        { "f32", cfg_f32 },
+        { "f64", cfg_f64 },
+    }, {
+        "gaussian-fitting",
+        "total",
+    });
+}
+
+
+/*
+ * Compare cold and warm started gaussian fitting with early stopping against
+ * running all iterations.
+ */
+void bench_warm(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto cfg_full = TouchProcessorConfig{};
+    cfg_full.gfit_tolerance = 0.0f;
+
+    auto cfg_cold = TouchProcessorConfig{};
+
+    auto cfg_warm = TouchProcessorConfig{};
+    cfg_warm.gfit_warm_start = true;
+    cfg_warm.gfit_tolerance = 0.05f;
+
+    compare_contacts(heatmaps, { "cold", cfg_cold }, { "full", cfg_full });
+    compare_contacts(heatmaps, { "warm", cfg_warm }, { "full", cfg_full });
+
+    bench_processor(heatmaps, n_iter, {
+        { "full", cfg_full },
+        { "cold", cfg_cold },
+        { "warm", cfg_warm },
+    }, {
+        "gaussian-fitting",
+        "total",
+    });
+}
+
+
+/*
+ * Compare gaussian fitting on the calling thread only and across a pool of
+ * n_threads threads.
+ */
+void bench_threads(std::vector<Image<f32>> const& heatmaps, int n_iter, int n_threads)
+{
+    auto cfg_single = TouchProcessorConfig{};
+
+    auto cfg_pool = TouchProcessorConfig{};
+    cfg_pool.threads = n_threads;
+
+    compare_contacts(heatmaps, { "pool", cfg_pool }, { "single", cfg_single });
+
+    bench_processor(heatmaps, n_iter, {
+        { "single", cfg_single },
+        { "pool", cfg_pool },
+    }, {
+        "gaussian-fitting",
+        "total",
+    });
+}
+
+/*
+ * Compare the dense stages on the full frame, split into n_threads row bands
+ * on the calling thread only, and split across a pool of n_threads threads.
+ */
+void bench_bands(std::vector<Image<f32>> const& heatmaps, int n_iter, int n_threads)
+{
+    auto cfg_full = TouchProcessorConfig{};
+
+    auto cfg_bands = TouchProcessorConfig{};
+    cfg_bands.bands = n_threads;
+
+    auto cfg_pool = TouchProcessorConfig{};
+    cfg_pool.bands = n_threads;
+    cfg_pool.threads = n_threads;
+
+    compare_contacts(heatmaps, { "bands", cfg_bands }, { "full", cfg_full });
+
+    bench_processor(heatmaps, n_iter, {
+        { "full", cfg_full },
+        { "bands", cfg_bands },
+        { "pool", cfg_pool },
+    }, {
+        "roi",
+        "structure-tensor+hessian",
+        "structure-tensor.eigenvalues",
+        "ridge",
+        "objective",
+        "filter",
+        "total",
+    });
+}
+
+/*
+ * Compare pixel- and run-based labeling, first as part of the processor, then
+ * on the heatmaps thresholded at their mean. Run-based labeling is also timed
+ * on heatmaps upscaled by a factor of four, which exceed the u16 forest of
+ * the pixel-based one.
+ */
+void bench_label(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto cfg_pixels = TouchProcessorConfig{};
+    cfg_pixels.label_engine = label_engine_type::pixels;
+
+    auto cfg_runs = TouchProcessorConfig{};
+    cfg_runs.label_engine = label_engine_type::runs;
+
+    compare_contacts(heatmaps, { "runs", cfg_runs }, { "pixels", cfg_pixels });
+
+    bench_processor(heatmaps, n_iter, {
+        { "pixels", cfg_pixels },
+        { "runs", cfg_runs },
+    }, {
+        "labels",
+        "total",
+    });
+
+    auto const size = heatmaps[0].size();
+    auto const scale = index_t { 4 };
+    auto const size_up = index2_t { size.x * scale, size.y * scale };
+
+    auto lbl_pixels = Image<u16> { size };
+    auto lbl_runs = Image<u16> { size };
+    auto lbl_up = Image<u32> { size_up };
+    auto forest = Image<u16> { size, Layout { 1, false } };
+    auto storage = alg::runs::Storage{};
+
+    auto reg = eval::perf::Registry{};
+    auto const t_pixels = reg.create_entry("pixels");
+    auto const t_runs = reg.create_entry("runs");
+    auto const t_up = reg.create_entry("runs, 4x upscaled");
+
+    auto n_diff = std::size_t { 0 };
+    auto up = Image<f32> { size_up };
+
+    for (auto const& hm : heatmaps) {
+        auto const th = std::accumulate(hm.begin(), hm.end(), 0.0f) / static_cast<f32>(size.span());
+
+        for (index_t y = 0; y < size_up.y; ++y) {
+            for (index_t x = 0; x < size_up.x; ++x) {
+                up[{ x, y }] = hm[{ x / scale, y / scale }];
+            }
+        }
+
+        for (int i = 0; i < n_iter; ++i) {
+            {
+                auto _r = reg.record(t_pixels);
+                alg::label<4>(lbl_pixels, hm, th, forest);
+            }
+
+            {
+                auto _r = reg.record(t_runs);
+                alg::runs::label<4>(lbl_runs, hm, th, storage);
+            }
+
+            {
+                auto _r = reg.record(t_up);
+                alg::runs::label<4>(lbl_up, up, th, storage);
+            }
+        }
+
+        n_diff += !std::equal(lbl_pixels.begin(), lbl_pixels.end(), lbl_runs.begin());
+    }
+
+    auto const& e_pixels = reg.get_entry(t_pixels);
+    auto const& e_runs = reg.get_entry(t_runs);
+
+    spdlog::info("Performance Statistics (heatmaps > mean):");
+    print_entry("u16", e_pixels);
+    print_entry("u16", e_runs);
+    print_entry("u32", reg.get_entry(t_up));
+    spdlog::info("  speedup:            {:.2f}x", e_pixels.r_mean_ns / e_runs.r_mean_ns);
+    spdlog::info("  differing labels:   {:8d}", n_diff);
+}
+
+/*
+ * Scalar reference for local maxima detection on images with halo.
+ */
+template<int C, typename T>
+void lmax_ref(std::vector<index_t>& out, Image<T> const& data, T threshold)
+{
+    auto const size = data.size();
+    auto const s = data.stride();
+
+    for (index_t y = 0; y < size.y; ++y) {
+        for (index_t x = 0; x < size.x; ++x) {
+            auto const* p = data.data() + y * s + x;
+
+            if (*p > threshold && alg::lmax::impl::is_max<C>(p, s)) {
+                out.push_back(y * size.x + x);
+            }
+        }
+    }
+}
+
+/*
+ * Compare scalar and SIMD local maxima detection on the heatmaps, then
+ * gaussian fitting with early stopping, started at the maximum pixels and at
+ * their sub-pixel peaks.
+ */
+void bench_lmax(std::vector<Image<f32>> const& heatmaps, int n_iter)
+{
+    auto const size = heatmaps[0].size();
+
+    auto halo = Image<f32> { size, Layout { 1, true } };
+    halo.fill_halo(std::numeric_limits<f32>::lowest());
+
+    auto max_ref = std::vector<index_t>{};
+    auto max_opt = std::vector<index_t>{};
+
+    auto reg = eval::perf::Registry{};
+    auto const t_ref = reg.create_entry("scalar");
+    auto const t_opt = reg.create_entry("simd");
+
+    auto n_diff = std::size_t { 0 };
+
+    for (auto const& hm : heatmaps) {
+        for (index_t y = 0; y < size.y; ++y) {
+            for (index_t x = 0; x < size.x; ++x) {
+                halo[{ x, y }] = hm[{ x, y }];
+            }
+        }
+
+        for (int i = 0; i < n_iter; ++i) {
+            {
+                auto _r = reg.record(t_ref);
+                max_ref.clear();
+                lmax_ref<8>(max_ref, halo, 0.05f);
+            }
+
+            {
+                auto _r = reg.record(t_opt);
+                max_opt.clear();
+                alg::find_local_maximas(halo, 0.05f, std::back_inserter(max_opt));
+            }
+        }
+
+        n_diff += max_ref != max_opt;
+    }
+
+    auto const& e_ref = reg.get_entry(t_ref);
+    auto const& e_opt = reg.get_entry(t_opt);
+
+    spdlog::info("Performance Statistics (local maximas of the heatmaps):");
+    print_entry("8-connected", e_ref);
+    print_entry("8-connected", e_opt);
+    spdlog::info("  speedup:            {:.2f}x", e_ref.r_mean_ns / e_opt.r_mean_ns);
+    spdlog::info("  differing maximas:  {:8d}", n_diff);
+    spdlog::info("");
+
+    auto cfg_pixel = TouchProcessorConfig{};
+    cfg_pixel.gfit_tolerance = 0.05f;
+
+    auto cfg_subpx = TouchProcessorConfig{};
+    cfg_subpx.gfit_tolerance = 0.05f;
+    cfg_subpx.gfit_subpixel_start = true;
+
+    compare_contacts(heatmaps, { "sub-pixel", cfg_subpx }, { "pixel", cfg_pixel });
+
+    bench_processor(heatmaps, n_iter, {
+        { "pixel", cfg_pixel },
+        { "sub-pixel", cfg_subpx },
+    }, {
+        "filter.maximas",
+        "gaussian-fitting",
+        "total",
+    });
+}
+
+/*
+ * Compare the float and fixed-point front ends: preprocessing and local
+ * maxima of the preprocessed heatmap on their own, then the contacts of the
+ * full processor.
+ */
+void bench_fixed(std::vector<Image<f32>> const& heatmaps, std::vector<RawHeatmap> const& raw,
+                 int n_iter)
+{
+    auto const size = heatmaps[0].size();
+    auto const n = static_cast<f32>(size.span());
+
+    auto const kern = alg::conv::kernels::gaussian_separable<f32, 5, 5>(0.9f);
+    auto const kern_fx = alg::fixed::quantize(kern);
+
+    auto pp = Image<f32> { size };
+    auto pp_fx = Image<i16> { size, Layout { 1, true } };
+    auto pp_cvt = Image<f32> { size };
+
+    pp_fx.fill_halo(std::numeric_limits<i16>::lowest());
+
+    auto max = std::vector<index_t>{};
+    auto max_fx = std::vector<index_t>{};
+
+    auto reg = eval::perf::Registry{};
+    auto const t_prep = reg.create_entry("preprocessing");
+    auto const t_prep_fx = reg.create_entry("preprocessing");
+    auto const t_lmax = reg.create_entry("maximas");
+    auto const t_lmax_fx = reg.create_entry("maximas");
+
+    auto d_max = 0.0f;
+    auto d_sum = 0.0;
+    auto n_diff_max = std::size_t { 0 };
+
+    for (std::size_t f = 0; f < heatmaps.size(); ++f) {
+        auto const& hm = heatmaps[f];
+        auto const& rw = raw[f];
+
+        auto const scale = alg::fixed::scale(rw.z_min, rw.z_max);
+
+        // empty range, nothing to compare
+        if (scale == 0.0f) {
+            continue;
+        }
+
+        auto const th_fx = static_cast<i16>(std::floor(0.05f / scale));
+
+        for (int i = 0; i < n_iter; ++i) {
+            {
+                auto _r = reg.record(t_prep);
+
+                auto const sum = alg::convolve_sum(pp, hm, kern);
+                alg::subtract_clamp(pp, sum / n);
+            }
+
+            {
+                auto _r = reg.record(t_prep_fx);
+
+                auto const sum = alg::fixed::convolve_sum(pp_fx, rw.data, rw.z_max, kern_fx);
+                auto const offs = static_cast<i16>(std::lround(static_cast<f32>(sum) / n));
+                alg::fixed::subtract_clamp_convert(pp_cvt, pp_fx, offs, scale);
+            }
+
+            {
+                auto _r = reg.record(t_lmax);
+                max.clear();
+                alg::find_local_maximas(pp, 0.05f, std::back_inserter(max));
+            }
+
+            {
+                auto _r = reg.record(t_lmax_fx);
+                max_fx.clear();
+                alg::find_local_maximas(pp_fx, th_fx, std::back_inserter(max_fx));
+            }
+        }
+
+        for (index_t i = 0; i < size.span(); ++i) {
+            auto const d = std::abs(pp[i] - pp_cvt[i]);
+
+            d_max = std::max(d_max, d);
+            d_sum += d;
+        }
+
+        n_diff_max += max != max_fx;
+    }
+
+    spdlog::info("Performance Statistics (float / fixed point):");
+    print_entry("f32", reg.get_entry(t_prep));
+    print_entry("u8/i16", reg.get_entry(t_prep_fx));
+    print_entry("f32", reg.get_entry(t_lmax));
+    print_entry("i16", reg.get_entry(t_lmax_fx));
+
+    spdlog::info("Accuracy (fixed point vs. float):");
+    spdlog::info("  preprocessed, max. abs. difference: {:e}", d_max);
+    spdlog::info("  preprocessed, avg. abs. difference: {:e}", d_sum / (heatmaps.size() * size.span()));
+    spdlog::info("  frames with differing maximas:      {:8d}", n_diff_max);
+    spdlog::info("");
+
+    auto proc = TouchProcessor { size };
+    auto proc_fx = TouchProcessor { size };
+
+    auto diff = ContactDiff{};
+
+    for (std::size_t f = 0; f < heatmaps.size(); ++f) {
+        diff.add(proc_fx.process(raw[f].data, raw[f].z_min, raw[f].z_max), proc.process(heatmaps[f]));
+    }
+
+    diff.print("fixed point", "float");
+
+    for (int i = 0; i < n_iter; ++i) {
+        for (std::size_t f = 0; f < heatmaps.size(); ++f) {
+            proc.process(heatmaps[f]);
+            proc_fx.process(raw[f].data, raw[f].z_min, raw[f].z_max);
+        }
+    }
+
+    spdlog::info("Performance Statistics:");
+
+    for (auto const* stage : { "preprocessing", "objective.maximas", "total" }) {
+        auto const* e = find_entry(proc.perf(), stage);
+        auto const* e_fx = find_entry(proc_fx.perf(), stage);
+
+        if (!e || !e_fx)
+            continue;
+
+        print_entry("float", *e);
+        print_entry("fixed point", *e_fx);
+    }
+}
+
+
+void bench_decode(std::vector<RawHeatmap> const& raw, int n_iter)
+{
+    auto const size = raw[0].data.size();
+
+    auto img = Image<f32> { size };
+    auto img_ref = Image<f32> { size };
+
+    auto decoder = HeatmapDecoder{};
+
+    auto reg = eval::perf::Registry{};
+    auto const t_ref = reg.create_entry("decode");
+    auto const t_lut = reg.create_entry("decode");
+
+    auto n_diff = std::size_t { 0 };
+
+    for (auto const& rw : raw) {
+        auto const data = gsl::as_bytes(gsl::span { rw.data.data(), static_cast<std::size_t>(size.span()) });
+
+        auto dim = IptsHeatmapDim{};
+        dim.width = static_cast<u8>(size.x);
+        dim.height = static_cast<u8>(size.y);
+        dim.z_min = rw.z_min;
+        dim.z_max = rw.z_max;
+
+        decoder.set_dim(dim);
+
+        for (int i = 0; i < n_iter; ++i) {
+            {
+                auto _r = reg.record(t_ref);
+
+                std::transform(data.begin(), data.end(), img_ref.begin(), [&](auto v) {
+                    auto const n = static_cast<f32>(dim.z_max - dim.z_min);
+                    auto const x = static_cast<f32>(std::to_integer<u8>(v) - dim.z_min);
+
+                    return 1.0f - x / n;
+                });
+            }
+
+            {
+                auto _r = reg.record(t_lut);
+                decoder.decode(img, data);
+            }
+        }
+
+        n_diff += !std::equal(img.begin(), img.end(), img_ref.begin());
+    }
+
+    spdlog::info("Performance Statistics:");
+    print_entry("per sample", reg.get_entry(t_ref));
+    print_entry("lookup table", reg.get_entry(t_lut));
+
+    spdlog::info("Frames with differing values: {}", n_diff);
+}
+
+/*
+ * Time a kernel on a fixed input, returns the token of the perf entry.
+ */
+template<class F>
+auto bench_kernel(eval::perf::Registry& reg, std::string name, int n_iter, F fn) -> eval::perf::Token
+{
+    auto const t = reg.create_entry(std::move(name));
+
+    for (int i = 0; i < n_iter; ++i) {
+        auto _r = reg.record(t);
+        fn();
+    }
+
+    return t;
+}
+
+void bench_conv(int n_iter)
+{
+    auto const size = index2_t { 72, 48 };
+    auto const kern_sep = alg::conv::kernels::gaussian_separable<f32, 5, 5>(1.0f);
+    auto const kern = kern_sep.outer();
+
+    // fixed pseudo-random input to keep runs comparable
+    auto rng = std::mt19937 { 42 };
+    auto dist = std::uniform_real_distribution<f32> { 0.0f, 1.0f };
+
+    auto in_f = Image<f32> { size };
+    auto in_m = Image<Mat2s<f32>> { size };
+
+    for (index_t i = 0; i < size.span(); ++i) {
+        in_f[i] = dist(rng);
+        in_m[i] = { dist(rng), dist(rng) - 0.5f, dist(rng) };
+    }
+
+    auto out_f_ref = Image<f32> { size };
+    auto out_f_opt = Image<f32> { size };
+    auto out_m_ref = Image<Mat2s<f32>> { size };
+    auto out_m_opt = Image<Mat2s<f32>> { size };
+    auto out_f_sep = Image<f32> { size };
+    auto out_m_sep = Image<Mat2s<f32>> { size };
+
+    auto reg = eval::perf::Registry{};
+
+    auto const t_f_ref = bench_kernel(reg, "conv-5x5.f32", n_iter, [&]() {
+        alg::conv::impl::conv_5x5_extend<f32, f32>(out_f_ref, in_f, kern);
+    });
+
+    auto const t_f_opt = bench_kernel(reg, "conv-5x5.f32", n_iter, [&]() {
+        alg::conv::impl::conv_5x5_extend_simd<f32, f32>(out_f_opt, in_f, kern);
+    });
+
+    auto const t_f_sep = bench_kernel(reg, "conv-5x5.f32", n_iter, [&]() {
+        alg::convolve(out_f_sep, in_f, kern_sep);
+    });
+
+    auto const t_m_ref = bench_kernel(reg, "conv-5x5.mat2s", n_iter, [&]() {
+        alg::conv::impl::conv_5x5_extend<Mat2s<f32>, f32>(out_m_ref, in_m, kern);
+    });
+
+    auto const t_m_opt = bench_kernel(reg, "conv-5x5.mat2s", n_iter, [&]() {
+        alg::conv::impl::conv_5x5_extend_simd<Mat2s<f32>, f32>(out_m_opt, in_m, kern);
+    });
+
+    auto const t_m_sep = bench_kernel(reg, "conv-5x5.mat2s", n_iter, [&]() {
+        alg::convolve(out_m_sep, in_m, kern_sep);
+    });
+
+    auto const& e_f_ref = reg.get_entry(t_f_ref);
+    auto const& e_f_opt = reg.get_entry(t_f_opt);
+    auto const& e_m_ref = reg.get_entry(t_m_ref);
+    auto const& e_m_opt = reg.get_entry(t_m_opt);
+    auto const& e_f_sep = reg.get_entry(t_f_sep);
+    auto const& e_m_sep = reg.get_entry(t_m_sep);
+
+    spdlog::info("Performance Statistics ({}x{}):", size.x, size.y);
+    print_entry("scalar", e_f_ref);
+    print_entry("simd", e_f_opt);
+    print_entry("separable", e_f_sep);
+    print_entry("scalar", e_m_ref);
+    print_entry("simd", e_m_opt);
+    print_entry("separable", e_m_sep);
+
+    spdlog::info("Speedup (simd / separable):");
+    spdlog::info("  f32:        {:.2f}x / {:.2f}x", e_f_ref.r_mean_ns / e_f_opt.r_mean_ns,
+                 e_f_ref.r_mean_ns / e_f_sep.r_mean_ns);
+    spdlog::info("  Mat2s<f32>: {:.2f}x / {:.2f}x", e_m_ref.r_mean_ns / e_m_opt.r_mean_ns,
+                 e_m_ref.r_mean_ns / e_m_sep.r_mean_ns);
+    spdlog::info("");
+
+    spdlog::info("Maximum absolute difference (simd / separable):");
+    spdlog::info("  f32:        {:e} / {:e}", max_abs_diff(out_f_ref, out_f_opt), max_abs_diff(out_f_ref, out_f_sep));
+    spdlog::info("  Mat2s<f32>: {:e} / {:e}", max_abs_diff(out_m_ref, out_m_opt), max_abs_diff(out_m_ref, out_m_sep));
+}
+
+
+void bench_eigen(int n_iter)
+{
+    auto const size = index2_t { 72, 48 };
+
+    auto rng = std::mt19937 { 42 };
+    auto dist = std::uniform_real_distribution<f32> { -1.0f, 1.0f };
+
+    auto in = Image<Mat2s<f32>> { size };
+    for (index_t i = 0; i < size.span(); ++i) {
+        in[i] = { dist(rng), dist(rng), dist(rng) };
+    }
+
+    auto ev_ref = Image<std::array<f32, 2>> { size };
+    auto ev_opt = Image<std::array<f32, 2>> { size };
+    auto ps_ref = Image<f32> { size };
+    auto ps_opt = Image<f32> { size };
+    auto coh = Image<f32> { size };
+
+    auto reg = eval::perf::Registry{};
+
+    auto const t_ev_ref = bench_kernel(reg, "eigenvalues", n_iter, [&]() {
+        container::ops::transform(in, ev_ref, [](auto const& m) {
+            return m.eigenvalues();
+        });
+    });
+
+    auto const t_ev_opt = bench_kernel(reg, "eigenvalues", n_iter, [&]() {
+        alg::eigenvalues(ev_opt, in);
+    });
+
+    auto const t_ps_ref = bench_kernel(reg, "eigenvalues.pos-sum", n_iter, [&]() {
+        container::ops::transform(in, ps_ref, [](auto const& m) {
+            auto const [ev1, ev2] = m.eigenvalues();
+            return std::max(ev1, 0.0f) + std::max(ev2, 0.0f);
+        });
+    });
+
+    auto const t_ps_opt = bench_kernel(reg, "eigenvalues.pos-sum", n_iter, [&]() {
+        alg::eigenvalues_pos_sum(ps_opt, in);
+    });
+
+    auto const t_pc_opt = bench_kernel(reg, "eigenvalues.pos-sum+coherence", n_iter, [&]() {
+        alg::eigenvalues_pos_sum_coherence(ps_opt, coh, in);
+    });
+
+    auto const& e_ev_ref = reg.get_entry(t_ev_ref);
+    auto const& e_ev_opt = reg.get_entry(t_ev_opt);
+    auto const& e_ps_ref = reg.get_entry(t_ps_ref);
+    auto const& e_ps_opt = reg.get_entry(t_ps_opt);
+    auto const& e_pc_opt = reg.get_entry(t_pc_opt);
+
+    spdlog::info("Performance Statistics ({}x{}):", size.x, size.y);
+    print_entry("scalar", e_ev_ref);
+    print_entry("bulk", e_ev_opt);
+    print_entry("scalar", e_ps_ref);
+    print_entry("bulk", e_ps_opt);
+    print_entry("bulk", e_pc_opt);
+
+    spdlog::info("Speedup:");
+    spdlog::info("  eigenvalues: {:.2f}x", e_ev_ref.r_mean_ns / e_ev_opt.r_mean_ns);
+    spdlog::info("  pos-sum:     {:.2f}x", e_ps_ref.r_mean_ns / e_ps_opt.r_mean_ns);
+    spdlog::info("");
+
+    spdlog::info("Maximum absolute difference:");
+    spdlog::info("  eigenvalues: {:e}", max_abs_diff(ev_ref, ev_opt));
+    spdlog::info("  pos-sum:     {:e}", max_abs_diff(ps_ref, ps_opt));
+}
+
+
+/*
+ * Reference assembly of the gaussian fitting system, accumulating each entry
+ * of the matrix per pixel.
+ */
+template<class T, class S>
+void gfit_assemble_ref(Mat6<S>& m, Vec6<S>& rhs, alg::gfit::BBox const& b, Image<T> const& data,
+                       alg::gfit::Window<S> const& w)
+{
+    auto const eps = std::numeric_limits<S>::epsilon();
+    auto const range = alg::gfit::range<S>;
+
+    auto const scale = Vec2<S> {
+        static_cast<S>(2) * range.x / static_cast<S>(data.size().x),
+        static_cast<S>(2) * range.y / static_cast<S>(data.size().y),
+    };
+
+    auto const c = alg::gfit::impl::center(b);
+
+    std::fill(m.data.begin(), m.data.end(), static_cast<S>(0));
+    std::fill(rhs.data.begin(), rhs.data.end(), static_cast<S>(0));
+
+    for (index_t iy = b.ymin; iy <= b.ymax; ++iy) {
+        for (index_t ix = b.xmin; ix <= b.xmax; ++ix) {
+            auto const x = static_cast<S>(ix - c.x) * scale.x;
+            auto const y = static_cast<S>(iy - c.y) * scale.y;
+
+            auto const d = w[{ix - b.xmin, iy - b.ymin}] * static_cast<S>(data[{ix, iy}]);
+            auto const v = std::log(d + eps) * d * d;
+
+            auto const phi = std::array<S, 6> { x * x, 2 * x * y, y * y, x, y, static_cast<S>(1) };
+
+            for (index_t i = 0; i < 6; ++i) {
+                rhs[i] += v * phi[i];
+
+                for (index_t j = 0; j < 6; ++j) {
+                    m[{i, j}] += d * d * phi[i] * phi[j];
+                }
+            }
+        }
+    }
+}
+
+void bench_gfit(int n_iter)
+{
+    auto const size = index2_t { 72, 48 };
+    auto const window = alg::gfit::window_size;
+    auto const bounds = alg::gfit::BBox { 30, 40, 20, 30 };
+
+    auto rng = std::mt19937 { 42 };
+    auto noise = std::uniform_real_distribution<f32> { 0.0f, 0.05f };
+
+    // a single blob with some noise
+    auto data = Image<f32> { size };
+    for (index_t y = 0; y < size.y; ++y) {
+        for (index_t x = 0; x < size.x; ++x) {
+            auto const dx = static_cast<f32>(x) - 35.3f;
+            auto const dy = static_cast<f32>(y) - 24.6f;
+
+            data[{x, y}] = std::exp(-(dx * dx + dy * dy) / 8.0f) + noise(rng);
+        }
+    }
+
+    auto weights = alg::gfit::Window<f64> {};
+    weights.data.fill(1.0);
+
+    auto m_ref = Mat6<f64> {};
+    auto m_opt = Mat6<f64> {};
+    auto r_ref = Vec6<f64> {};
+    auto r_opt = Vec6<f64> {};
+
+    auto reg = eval::perf::Registry{};
+
+    auto const t_ref = bench_kernel(reg, "gfit.assemble", n_iter, [&]() {
+        gfit_assemble_ref(m_ref, r_ref, bounds, data, weights);
+    });
+
+    auto const t_opt = bench_kernel(reg, "gfit.assemble", n_iter, [&]() {
+        alg::gfit::impl::assemble_system(m_opt, r_opt, bounds, data, weights);
+    });
+
+    // solve one batch worth of systems
+    constexpr auto n_batch = math::ldlt_batch_size<f64>;
+
+    auto sys = std::array<Mat6<f64>, n_batch> {};
+    auto rhs = std::array<Vec6<f64>, n_batch> {};
+    auto chi_ge = std::array<Vec6<f64>, n_batch> {};
+    auto chi_ldlt = std::array<Vec6<f64>, n_batch> {};
+    auto chi_batch = std::array<Vec6<f64>, n_batch> {};
+    auto ok = std::array<bool, n_batch> {};
+
+    std::fill(sys.begin(), sys.end(), m_opt);
+    std::fill(rhs.begin(), rhs.end(), r_opt);
+
+    auto const t_ge = bench_kernel(reg, "gfit.solve", n_iter, [&]() {
+        for (std::size_t i = 0; i < n_batch; ++i) {
+            ok[i] = math::ge_solve(sys[i], rhs[i], chi_ge[i]);
+        }
+    });
+
+    auto const t_ldlt = bench_kernel(reg, "gfit.solve", n_iter, [&]() {
+        for (std::size_t i = 0; i < n_batch; ++i) {
+            ok[i] = math::ldlt_solve(sys[i], rhs[i], chi_ldlt[i]);
+        }
+    });
+
+    auto const t_batch = bench_kernel(reg, "gfit.solve", n_iter, [&]() {
+        math::ldlt_solve_batch(sys, rhs, chi_batch, ok, n_batch);
+    });
+
+    auto const& e_ref = reg.get_entry(t_ref);
+    auto const& e_opt = reg.get_entry(t_opt);
+    auto const& e_ge = reg.get_entry(t_ge);
+    auto const& e_ldlt = reg.get_entry(t_ldlt);
+    auto const& e_batch = reg.get_entry(t_batch);
+
+    auto d_solve = 0.0;
+    for (std::size_t i = 0; i < n_batch; ++i) {
+        for (index_t k = 0; k < 6; ++k) {
+            auto const norm = std::abs(chi_ge[i][k]);
+
+            d_solve = std::max(d_solve, std::abs(chi_ldlt[i][k] - chi_ge[i][k]) / norm);
+            d_solve = std::max(d_solve, std::abs(chi_batch[i][k] - chi_ge[i][k]) / norm);
+        }
+    }
+
+    auto d_max = 0.0;
+    for (std::size_t i = 0; i < m_ref.data.size(); ++i) {
+        d_max = std::max(d_max, std::abs(m_ref.data[i] - m_opt.data[i]) / std::abs(m_ref.data[i]));
+    }
+    for (std::size_t i = 0; i < r_ref.data.size(); ++i) {
+        d_max = std::max(d_max, std::abs(r_ref.data[i] - r_opt.data[i]) / std::abs(r_ref.data[i]));
+    }
+
+    spdlog::info("Performance Statistics ({}x{} window):", window.x, window.y);
+    print_entry("per-entry", e_ref);
+    print_entry("moments", e_opt);
+
+    spdlog::info("Performance Statistics ({} systems):", n_batch);
+    print_entry("lu", e_ge);
+    print_entry("ldlt", e_ldlt);
+    print_entry("ldlt-batch", e_batch);
+
+    spdlog::info("Speedup:");
+    spdlog::info("  assembly:           {:.2f}x", e_ref.r_mean_ns / e_opt.r_mean_ns);
+    spdlog::info("  solve (ldlt/batch): {:.2f}x / {:.2f}x", e_ge.r_mean_ns / e_ldlt.r_mean_ns,
+                 e_ge.r_mean_ns / e_batch.r_mean_ns);
+    spdlog::info("");
+
+    spdlog::info("Maximum relative difference:");
+    spdlog::info("  assembly:           {:e}", d_max);
+    spdlog::info("  solve:              {:e}", d_solve);
+}
+
+
+/*
+ * Reference weight update, evaluating, summing, and normalizing all Gaussians
+ * over the full frame in separate passes.
+ */
+template<class T>
+void gfit_weights_ref(std::vector<alg::gfit::Parameters<T>>& params, Image<T>& total)
+{
+    auto const range = alg::gfit::range<T>;
+
+    auto const scale = Vec2<T> {
+        static_cast<T>(2) * range.x / static_cast<T>(total.size().x),
+        static_cast<T>(2) * range.y / static_cast<T>(total.size().y),
+    };
+
+    std::fill(total.begin(), total.end(), static_cast<T>(0));
+
+    for (auto& p : params) {
+        for (index_t iy = p.bounds.ymin; iy <= p.bounds.ymax; ++iy) {
+            for (index_t ix = p.bounds.xmin; ix <= p.bounds.xmax; ++ix) {
+                auto const x = static_cast<T>(ix) * scale.x - range.x;
+                auto const y = static_cast<T>(iy) * scale.y - range.y;
+
+                auto const v = p.scale * alg::gfit::impl::gaussian_like<T>({x, y}, p.mean, p.prec);
+
+                p.weights[{ix - p.bounds.xmin, iy - p.bounds.ymin}] = v;
+                total[{ix, iy}] += v;
+            }
+        }
+    }
+
+    for (auto& p : params) {
+        for (index_t iy = p.bounds.ymin; iy <= p.bounds.ymax; ++iy) {
+            for (index_t ix = p.bounds.xmin; ix <= p.bounds.xmax; ++ix) {
+                if (total[{ix, iy}] > static_cast<T>(0)) {
+                    p.weights[{ix - p.bounds.xmin, iy - p.bounds.ymin}] /= total[{ix, iy}];
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Contacts on a grid with a spacing of 9 pixels horizontally, so that
+ * neighboring windows in each row overlap, and 14 pixels vertically.
+ */
+template<class T>
+auto gfit_weights_contacts(index2_t size, std::size_t n) -> std::vector<alg::gfit::Parameters<T>>
+{
+    auto const range = alg::gfit::range<T>;
+    auto const window = alg::gfit::window_size;
+
+    auto const scale = Vec2<T> {
+        static_cast<T>(2) * range.x / static_cast<T>(size.x),
+        static_cast<T>(2) * range.y / static_cast<T>(size.y),
+    };
+
+    auto params = std::vector<alg::gfit::Parameters<T>> {};
+    alg::gfit::reserve(params, n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        auto& p = params[i];
+
+        auto const cx = static_cast<index_t>(12 + 9 * (i % 5));
+        auto const cy = static_cast<index_t>(12 + 14 * (i / 5));
+
+        p.valid = true;
+        p.scale = static_cast<T>(1);
+        p.mean.x = (static_cast<T>(cx) + static_cast<T>(0.3)) * scale.x - range.x;
+        p.mean.y = (static_cast<T>(cy) - static_cast<T>(0.2)) * scale.y - range.y;
+        p.prec.xx = static_cast<T>(1.0 / 2.25) / (scale.x * scale.x);
+        p.prec.xy = static_cast<T>(0.1) / (scale.x * scale.y);
+        p.prec.yy = static_cast<T>(1.0 / 3.0) / (scale.y * scale.y);
+        p.bounds = {
+            cx - (window.x - 1) / 2, cx + (window.x - 1) / 2,
+            cy - (window.y - 1) / 2, cy + (window.y - 1) / 2,
+        };
+    }
+
+    return params;
+}
+
+template<class T>
+void bench_weights_n(eval::perf::Registry& reg, std::size_t n, int n_iter)
+{
+    auto const size = index2_t { 72, 48 };
+
+    auto params_ref = gfit_weights_contacts<T>(size, n);
+    auto params_opt = gfit_weights_contacts<T>(size, n);
+
+    auto total = Image<T> { size };
+
+    auto const t_ref = bench_kernel(reg, "gfit.weights", n_iter, [&]() {
+        gfit_weights_ref(params_ref, total);
+    });
+
+    auto const t_opt = bench_kernel(reg, "gfit.weights", n_iter, [&]() {
+        alg::gfit::impl::update_weight_maps(params_opt, total);
+    });
+
+    auto d_max = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t k = 0; k < params_ref[i].weights.data.size(); ++k) {
+            auto const d = params_ref[i].weights.data[k] - params_opt[i].weights.data[k];
+            d_max = std::max(d_max, static_cast<f64>(std::abs(d)));
+        }
+    }
+
+    auto const& e_ref = reg.get_entry(t_ref);
+    auto const& e_opt = reg.get_entry(t_opt);
+
+    spdlog::info("Performance Statistics ({} contacts, {}):", n, std::is_same_v<T, f32> ? "f32" : "f64");
+    print_entry("reference", e_ref);
+    print_entry("sparse", e_opt);
+    spdlog::info("  speedup:            {:.2f}x", e_ref.r_mean_ns / e_opt.r_mean_ns);
+    spdlog::info("  max. difference:    {:e}", d_max);
+    spdlog::info("");
+}
+
+/*
+ * Check that the weights of a single, isolated contact match the reference,
+ * including non-positive scales and Gaussians that vanish inside the window.
+ * Pixels where the Gaussian is below the range of math::exp_approx() are
+ * zero for all windows, not only isolated ones, and are counted separately.
+ */
+template<class T>
+void check_weights_isolated()
+{
+    auto const size = index2_t { 72, 48 };
+    auto const range = alg::gfit::range<T>;
+
+    auto const scale_px = Vec2<T> {
+        static_cast<T>(2) * range.x / static_cast<T>(size.x),
+        static_cast<T>(2) * range.y / static_cast<T>(size.y),
+    };
+
+    auto const g_min = std::exp(-math::exp_max<T>);
+
+    spdlog::info("Isolated window ({}):", std::is_same_v<T, f32> ? "f32" : "f64");
+
+    for (auto const narrow : { false, true }) {
+        for (auto const scale : { 1.0, 0.0, -0.5 }) {
+            auto params_ref = gfit_weights_contacts<T>(size, 1);
+            auto params_opt = gfit_weights_contacts<T>(size, 1);
+
+            for (auto* params : { &params_ref, &params_opt }) {
+                auto& p = (*params)[0];
+
+                p.scale = static_cast<T>(scale);
+
+                if (narrow) {
+                    p.prec.xx *= static_cast<T>(200);
+                    p.prec.xy = static_cast<T>(0);
+                    p.prec.yy *= static_cast<T>(200);
+                }
+            }
+
+            auto total = Image<T> { size };
+
+            gfit_weights_ref(params_ref, total);
+            alg::gfit::impl::update_weight_maps(params_opt, total);
+
+            auto const& p = params_ref[0];
+            auto const n = alg::gfit::size(p.bounds);
+
+            auto d_max = 0.0;
+            auto n_cut = 0;
+
+            for (index_t iy = 0; iy < n.y; ++iy) {
+                for (index_t ix = 0; ix < n.x; ++ix) {
+                    auto const x = static_cast<T>(p.bounds.xmin + ix) * scale_px.x - range.x;
+                    auto const y = static_cast<T>(p.bounds.ymin + iy) * scale_px.y - range.y;
+
+                    if (alg::gfit::impl::gaussian_like<T>({ x, y }, p.mean, p.prec) < g_min) {
+                        n_cut += 1;
+                        continue;
+                    }
+
+                    auto const d = p.weights[{ ix, iy }] - params_opt[0].weights[{ ix, iy }];
+                    d_max = std::max(d_max, static_cast<f64>(std::abs(d)));
+                }
+            }
+
+            spdlog::info("  {:6}, scale {:4}: max. difference {:e} ({} pixels below range)",
+                         narrow ? "narrow" : "wide", scale, d_max, n_cut);
+        }
+    }
+
+    spdlog::info("");
+}
+
+void bench_weights(int n_iter)
+{
+    auto reg = eval::perf::Registry{};
+
+    check_weights_isolated<f64>();
+    check_weights_isolated<f32>();
+
+    for (std::size_t n : { 1, 5, 10 }) {
+        bench_weights_n<f64>(reg, n, n_iter);
+        bench_weights_n<f32>(reg, n, n_iter);
+    }
+}
+
+
+enum class mode_type {
+    wdt,
+    prep,
+    deriv,
+    roi,
+    precision,
+    warm,
+    threads,
+    bands,
+    label,
+    lmax,
+    fixed,
+    decode,
+    conv,
+    eigen,
+    gfit,
+    weights,
+};
+
+auto main(int argc, char** argv) -> int
+{
+    spdlog::set_pattern("[%X.%e] [%^%l%$] %v");
+
+    auto mode = mode_type::wdt;
+    auto paths_in = std::vector<std::string>{};
+    auto n_iter = 50;
+    auto n_threads = 4;
+
+    // the micro-benchmarks run much faster than a pass over the input data
+    auto n_iter_conv = 10000;
+    auto n_iter_eigen = 10000;
+    auto n_iter_gfit = 10000;
+    auto n_iter_weights = 10000;
+
+    auto app = CLI::App { "Digitizer Prototype -- Benchmarks" };
+    app.failure_message(CLI::FailureMessage::help);
+    app.set_help_all_flag("--help-all", "Show full help message");
+    app.require_subcommand(1);
+
+    auto cmd_wdt = app.add_subcommand("wdt", "Compare priority queues for the distance transform");
+    cmd_wdt->callback([&]() { mode = mode_type::wdt; });
+    cmd_wdt->add_option("input", paths_in, "Input files")->required();
+    cmd_wdt->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_prep = app.add_subcommand("prep", "Compare mean subtraction modes for preprocessing");
+    cmd_prep->callback([&]() { mode = mode_type::prep; });
+    cmd_prep->add_option("input", paths_in, "Input files")->required();
+    cmd_prep->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_deriv = app.add_subcommand("deriv", "Compare structure tensor and hessian pipelines and layouts");
+    cmd_deriv->callback([&]() { mode = mode_type::deriv; });
+    cmd_deriv->add_option("input", paths_in, "Input files")->required();
+    cmd_deriv->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_roi = app.add_subcommand("roi", "Compare full-frame and region of interest processing");
+    cmd_roi->callback([&]() { mode = mode_type::roi; });
+    cmd_roi->add_option("input", paths_in, "Input files")->required();
+    cmd_roi->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_prec = app.add_subcommand("precision", "Compare single and double precision gaussian fitting");
+    cmd_prec->callback([&]() { mode = mode_type::precision; });
+    cmd_prec->add_option("input", paths_in, "Input files")->required();
+    cmd_prec->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_warm = app.add_subcommand("warm", "Compare cold and warm started gaussian fitting");
+    cmd_warm->callback([&]() { mode = mode_type::warm; });
+    cmd_warm->add_option("input", paths_in, "Input files")->required();
+    cmd_warm->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_threads = app.add_subcommand("threads", "Compare single-threaded and pooled gaussian fitting");
+    cmd_threads->callback([&]() { mode = mode_type::threads; });
+    cmd_threads->add_option("input", paths_in, "Input files")->required();
+    cmd_threads->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+    cmd_threads->add_option("-t,--threads", n_threads, "Number of threads in the pool");
+
+    auto cmd_bands = app.add_subcommand("bands", "Compare full-frame and banded dense stages");
+    cmd_bands->callback([&]() { mode = mode_type::bands; });
+    cmd_bands->add_option("input", paths_in, "Input files")->required();
+    cmd_bands->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+    cmd_bands->add_option("-t,--threads", n_threads, "Number of bands and threads in the pool");
+
+    auto cmd_label = app.add_subcommand("label", "Compare pixel- and run-based connected component labeling");
+    cmd_label->callback([&]() { mode = mode_type::label; });
+    cmd_label->add_option("input", paths_in, "Input files")->required();
+    cmd_label->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_lmax = app.add_subcommand("lmax", "Compare scalar and SIMD local maxima, and sub-pixel fitting starts");
+    cmd_lmax->callback([&]() { mode = mode_type::lmax; });
+    cmd_lmax->add_option("input", paths_in, "Input files")->required();
+    cmd_lmax->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_fixed = app.add_subcommand("fixed", "Compare float and fixed-point preprocessing of the raw samples");
+    cmd_fixed->callback([&]() { mode = mode_type::fixed; });
+    cmd_fixed->add_option("input", paths_in, "Input files")->required();
+    cmd_fixed->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_decode = app.add_subcommand("decode", "Compare per-sample and lookup table heatmap decoding");
+    cmd_decode->callback([&]() { mode = mode_type::decode; });
+    cmd_decode->add_option("input", paths_in, "Input files")->required();
+    cmd_decode->add_option("-n,--iterations", n_iter, "Number of passes over the input data");
+
+    auto cmd_conv = app.add_subcommand("conv", "Compare scalar, SIMD, and separable 5x5 convolution kernels");
+    cmd_conv->callback([&]() { mode = mode_type::conv; });
+    cmd_conv->add_option("-n,--iterations", n_iter_conv, "Number of kernel invocations");
+
+    auto cmd_eigen = app.add_subcommand("eigen", "Compare per-pixel and bulk 2x2 eigenvalue kernels");
+    cmd_eigen->callback([&]() { mode = mode_type::eigen; });
+    cmd_eigen->add_option("-n,--iterations", n_iter_eigen, "Number of kernel invocations");
+
+    auto cmd_gfit = app.add_subcommand("gfit", "Compare gaussian fitting system assembly and solvers");
+    cmd_gfit->callback([&]() { mode = mode_type::gfit; });
+    cmd_gfit->add_option("-n,--iterations", n_iter_gfit, "Number of kernel invocations");
+
+    auto cmd_weights = app.add_subcommand("weights", "Compare dense and sparse gaussian fitting weight updates");
+    cmd_weights->callback([&]() { mode = mode_type::weights; });
+    cmd_weights->add_option("-n,--iterations", n_iter_weights, "Number of kernel invocations");
+
+    CLI11_PARSE(app, argc, argv);
+
+    // micro-benchmarks on synthetic data
+    switch (mode) {
+    case mode_type::conv:
+        bench_conv(n_iter_conv);
+        return 0;
+
+    case mode_type::eigen:
+        bench_eigen(n_iter_eigen);
+        return 0;
+
+    case mode_type::gfit:
+        bench_gfit(n_iter_gfit);
+        return 0;
+
+    case mode_type::weights:
+        bench_weights(n_iter_weights);
+        return 0;
+
+    default:
+        break;
+    }
+
+    auto const heatmaps = load_heatmaps(paths_in);
+
+    if (heatmaps.empty()) {
+        spdlog::warn("No touch data found!");
+        return 0;
+    }
+
+    switch (mode) {
+    case mode_type::wdt:
+        bench_wdt(heatmaps, n_iter);
+        break;
+
+    case mode_type::prep:
+        bench_prep(heatmaps, n_iter);
+        break;
+
+    case mode_type::deriv:
+        bench_deriv(heatmaps, n_iter);
+        break;
+
+    case mode_type::roi:
+        bench_roi(heatmaps, n_iter);
+        break;
+
+    case mode_type::precision:
+        bench_precision(heatmaps, n_iter);
+        break;
+
+    case mode_type::warm:
+        bench_warm(heatmaps, n_iter);
+        break;
+
+    case mode_type::threads:
+        bench_threads(heatmaps, n_iter, n_threads);
+        break;
+
+    case mode_type::bands:
+        bench_bands(heatmaps, n_iter, n_threads);
+        break;
+
+    case mode_type::label:
+        bench_label(heatmaps, n_iter);
+        break;
+
+    case mode_type::lmax:
+        bench_lmax(heatmaps, n_iter);
+        break;
+
+    case mode_type::fixed:
+        bench_fixed(heatmaps, load_raw_heatmaps(paths_in), n_iter);
+        break;
+
+    case mode_type::decode:
+        bench_decode(load_raw_heatmaps(paths_in), n_iter);
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
+}
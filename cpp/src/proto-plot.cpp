@@ -1,5 +1,6 @@
 #include "processor.hpp"
 #include "parser.hpp"
+#include "heatmap_decoder.hpp"
 #include "types.hpp"
 #include "visualization.hpp"
 
@@ -39,22 +40,34 @@ auto read_file(char const* path) -> std::vector<u8>
 }
 
 
+/*
+ * Decoded heatmap, plus the raw samples with their range for the
+ * fixed-point path (see TouchProcessor::process(Image<u8>, ...)).
+ */
+struct Heatmap {
+    Image<f32> data;
+    Image<u8> raw;
+    u8 z_min;
+    u8 z_max;
+};
+
+
 class Parser : public ParserBase {
 private:
-    std::vector<Image<f32>> m_data;
-    IptsHeatmapDim m_dim;
+    std::vector<Heatmap> m_data;
+    HeatmapDecoder m_decoder;
 
 public:
-    auto parse(char const* file) -> std::vector<Image<f32>>;
+    auto parse(char const* file) -> std::vector<Heatmap>;
 
 protected:
     virtual void on_heatmap_dim(IptsHeatmapDim const& dim);
     virtual void on_heatmap(gsl::span<const std::byte> const& data);
 };
 
-auto Parser::parse(char const* file) -> std::vector<Image<f32>>
+auto Parser::parse(char const* file) -> std::vector<Heatmap>
 {
-    m_data = std::vector<Image<f32>>{};
+    m_data = std::vector<Heatmap>{};
 
     auto const data = read_file(file);
     this->do_parse(gsl::as_bytes(gsl::span{data}));
@@ -64,21 +77,20 @@ auto Parser::parse(char const* file) -> std::vector<Image<f32>>
 
 void Parser::on_heatmap_dim(IptsHeatmapDim const& dim)
 {
-    m_dim = dim;
+    m_decoder.set_dim(dim);
 }
 
 void Parser::on_heatmap(gsl::span<const std::byte> const& data)
 {
-    auto img = Image<f32> {{ m_dim.width, m_dim.height }};
+    auto const& dim = m_decoder.dim();
 
-    std::transform(data.begin(), data.end(), img.begin(), [&](auto v) {
-        auto const n = static_cast<f32>(m_dim.z_max - m_dim.z_min);
-        auto const x = static_cast<f32>(std::to_integer<u8>(v) - m_dim.z_min);
+    auto img = Image<f32> { m_decoder.size() };
+    m_decoder.decode(img, data);
 
-        return 1.0f - x / n;
-    });
+    auto raw = Image<u8> { m_decoder.size() };
+    m_decoder.decode(raw, data);
 
-    m_data.push_back(img);
+    m_data.push_back(Heatmap { img, raw, dim.z_min, dim.z_max });
 }
 
 
@@ -94,11 +106,13 @@ auto main(int argc, char** argv) -> int
     auto mode = mode_type::plot;
     auto path_in = std::string{};
     auto path_out = std::string{};
+    auto fixed_point = false;
 
     auto app = CLI::App { "Digitizer Prototype -- Plotter" };
     app.failure_message(CLI::FailureMessage::help);
     app.set_help_all_flag("--help-all", "Show full help message");
     app.require_subcommand(1);
+    app.add_flag("--fixed-point", fixed_point, "Preprocess the raw heatmap samples in fixed point");
 
     auto cmd_plot = app.add_subcommand("plot", "Plot results to PNG files");
     cmd_plot->callback([&]() { mode = mode_type::plot; });
@@ -118,7 +132,7 @@ auto main(int argc, char** argv) -> int
         return 0;
     }
 
-    auto proc = TouchProcessor { heatmaps[0].size() };
+    auto proc = TouchProcessor { heatmaps[0].data.size() };
 
     auto out = std::vector<Image<f32>>{};
     out.reserve(heatmaps.size());
@@ -131,9 +145,11 @@ auto main(int argc, char** argv) -> int
     int __i = 0;
     do {
         for (auto const& hm : heatmaps) {
-            auto const& tp = proc.process(hm);
+            auto const& tp = fixed_point
+                ? proc.process(hm.raw, hm.z_min, hm.z_max)
+                : proc.process(hm.data);
 
-            out.push_back(hm);
+            out.push_back(hm.data);
             out_tp.push_back(tp);
         }
     } while (++__i < 50 && mode == mode_type::perf);
@@ -154,6 +170,19 @@ auto main(int argc, char** argv) -> int
         spdlog::info("");
     }
 
+    for (auto const& c : proc.perf().counters()) {
+        if (c.n_samples == 0)
+            continue;
+
+        spdlog::info("  {}", c.name);
+        spdlog::info("    N:      {:8d}", c.n_samples);
+        spdlog::info("    mean:   {:8.4f}", c.mean());
+        spdlog::info("    stddev: {:8.4f}", c.stddev());
+        spdlog::info("    min:    {:8.4f}", c.minimum);
+        spdlog::info("    max:    {:8.4f}", c.maximum);
+        spdlog::info("");
+    }
+
     if (mode == mode_type::perf) {
         return 0;
     }
@@ -170,7 +199,7 @@ auto main(int argc, char** argv) -> int
     auto surface = gfx::cairo::image_surface_create(gfx::cairo::Format::Argb32, { width, height });
     auto cr = gfx::cairo::Cairo::create(surface);
 
-    auto vis = Visualization { heatmaps[0].size() };
+    auto vis = Visualization { heatmaps[0].data.size() };
 
     for (std::size_t i = 0; i < out.size(); ++i) {
         vis.draw(cr, out[i], out_tp[i], width, height);
@@ -6,6 +6,7 @@
 
 #include "processor.hpp"
 #include "parser.hpp"
+#include "heatmap_decoder.hpp"
 #include "types.hpp"
 #include "visualization.hpp"
 
@@ -16,6 +17,7 @@
 #include "gfx/cairo.hpp"
 #include "gfx/gtk.hpp"
 
+#include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
 
 #include <vector>
@@ -38,18 +40,24 @@ public:
 
     auto parse(gsl::span<const std::byte> data) -> Image<f32> const&;
 
+    // raw samples of the last heatmap, see TouchProcessor::process(Image<u8>, ...)
+    auto raw() const -> Image<u8> const&;
+    auto dim() const -> IptsHeatmapDim const&;
+
 protected:
     virtual void on_heatmap_dim(IptsHeatmapDim const& dim);
     virtual void on_heatmap(gsl::span<const std::byte> const& data);
 
 private:
-    IptsHeatmapDim m_dim;
+    HeatmapDecoder m_decoder;
     Image<f32>     m_img;
+    Image<u8>      m_raw;
 };
 
 Parser::Parser(index2_t size)
-    : m_dim{}
+    : m_decoder{}
     , m_img { size }
+    , m_raw { size }
 {}
 
 auto Parser::parse(gsl::span<const std::byte> data) -> Image<f32> const&
@@ -58,24 +66,30 @@ auto Parser::parse(gsl::span<const std::byte> data) -> Image<f32> const&
     return m_img;
 }
 
+auto Parser::raw() const -> Image<u8> const&
+{
+    return m_raw;
+}
+
+auto Parser::dim() const -> IptsHeatmapDim const&
+{
+    return m_decoder.dim();
+}
+
 void Parser::on_heatmap_dim(IptsHeatmapDim const& dim)
 {
-    m_dim = dim;
+    m_decoder.set_dim(dim);
 }
 
 void Parser::on_heatmap(gsl::span<const std::byte> const& data)
 {
-    if (m_dim.width != m_img.size().x || m_dim.height != m_img.size().y) {
+    if (m_decoder.size() != m_img.size() || data.size() != static_cast<std::size_t>(m_img.size().span())) {
         spdlog::error("invalid heatmap size");
         abort();
     }
 
-    std::transform(data.begin(), data.end(), m_img.begin(), [&](auto v) {
-        auto const n = static_cast<f32>(m_dim.z_max - m_dim.z_min);
-        auto const x = static_cast<f32>(std::to_integer<u8>(v) - m_dim.z_min);
-
-        return 1.0f - x / n;
-    });
+    m_decoder.decode(m_img, data);
+    m_decoder.decode(m_raw, data);
 }
 
 
@@ -165,13 +179,27 @@ auto main(int argc, char** argv) -> int
 {
     spdlog::set_pattern("[%X.%e] [%^%l%$] %v");
 
+    auto fixed_point = false;
+
+    auto cli = CLI::App { "Digitizer Prototype -- Real-Time" };
+    cli.failure_message(CLI::FailureMessage::help);
+    cli.add_flag("--fixed-point", fixed_point, "Preprocess the raw heatmap samples in fixed point");
+
+    CLI11_PARSE(cli, argc, argv);
+
     auto const size = index2_t { 72, 48 };
     auto ctx = MainContext { size };
-    auto prc = TouchProcessor { size };
 
     auto ctrl = iptsd_control {};
     iptsd_control_start(&ctrl);
 
+    auto cfg = TouchProcessorConfig {};
+    if (ctrl.device_info.max_contacts > 0) {
+        cfg.max_contacts = ctrl.device_info.max_contacts;
+    }
+
+    auto prc = TouchProcessor { size, cfg };
+
     auto app = Application::create("com.github.qzed.digitizer-prototype.rt");
 
     app.connect("activate", [&](Application app) -> void {
@@ -219,8 +247,12 @@ auto main(int argc, char** argv) -> int
                     return;
                 }
 
-                auto hm = p.parse(gsl::as_bytes(gsl::span{buf}));
-                ctx.submit(hm, prc.process(hm));
+                auto const& hm = p.parse(gsl::as_bytes(gsl::span{buf}));
+                auto const& tp = fixed_point
+                    ? prc.process(p.raw(), p.dim().z_min, p.dim().z_max)
+                    : prc.process(hm);
+
+                ctx.submit(hm, tp);
 
                 ret = iptsd_control_send_feedback(&ctrl);
                 if (ret < 0) {
@@ -233,7 +265,8 @@ auto main(int argc, char** argv) -> int
         }
     });
 
-    int status = app.run(argc, argv);
+    // options are handled above, don't pass them on to gtk
+    int status = app.run(1, argv);
 
     iptsd_control_stop(&ctrl);
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "types.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::utils::simd {
+
+#if defined(__AVX2__)
+
+/*
+ * Bitmask of two i16 compare results, i.e. vectors of 16 lanes each being
+ * either all zeros or all ones. Bit i of the result is set for lane i of lo,
+ * bit 16 + i for lane i of hi.
+ */
+inline auto movemask_epi16(__m256i lo, __m256i hi) -> u32
+{
+    // pack to bytes, packing works per 128 bit lane, so fix up the order
+    auto const m = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+
+    return static_cast<u32>(_mm256_movemask_epi8(m));
+}
+
+#endif
+
+} /* namespace iptsd::utils::simd */
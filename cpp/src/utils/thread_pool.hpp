@@ -0,0 +1,265 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+namespace iptsd::utils {
+
+/*
+ * Persistent pool of worker threads for running short, fine-grained parallel
+ * loops, i.e. multiple per frame.
+ *
+ * Between loops, workers spin for up to spin_time before parking on a
+ * condition variable, so that consecutive loops within one frame do not pay
+ * for waking up threads, while idle workers do not burn CPU time between
+ * frames. The calling thread takes part in each loop.
+ *
+ * run() only waits for the calls that have actually been started, not for
+ * all workers to check in. If the workers are not scheduled in time, e.g.
+ * because there are more threads than cores, the calling thread simply runs
+ * the whole loop by itself.
+ *
+ * run() must only be called from one thread at a time.
+ */
+class ThreadPool {
+public:
+    static constexpr auto spin_time = std::chrono::microseconds { 100 };
+    static constexpr unsigned spin_yield = 1024;
+
+    explicit ThreadPool(std::size_t n_threads);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    auto operator= (ThreadPool const&) -> ThreadPool& = delete;
+
+    auto size() const -> std::size_t;
+
+    template<class F>
+    void run(std::size_t n, F&& fn);
+
+private:
+    static void pause();
+
+    void worker();
+    void work();
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    std::atomic<u64> m_generation;
+    std::atomic<std::size_t> m_parked;
+    std::atomic<bool> m_stop;
+
+    // current loop: the number of indices in the upper and the next index in
+    // the lower 32 bits, so that an index is only ever claimed for the loop
+    // it belongs to, and the number of calls that have returned
+    std::atomic<u64> m_next;
+    std::atomic<std::size_t> m_done;
+
+    // only written while no index is claimed, published via m_next
+    void (*m_fn)(void*, std::size_t);
+    void* m_ctx;
+};
+
+
+/*
+ * Start a pool with n_threads threads in total, i.e. including the calling
+ * thread.
+ */
+inline ThreadPool::ThreadPool(std::size_t n_threads)
+    : m_threads{}
+    , m_lock{}
+    , m_cv{}
+    , m_generation{0}
+    , m_parked{0}
+    , m_stop{false}
+    , m_next{0}
+    , m_done{0}
+    , m_fn{nullptr}
+    , m_ctx{nullptr}
+{
+    for (std::size_t i = 1; i < n_threads; ++i) {
+        m_threads.emplace_back([this]() { worker(); });
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    m_stop.store(true);
+
+    {
+        auto const _l = std::lock_guard { m_lock };
+        m_generation.fetch_add(1);
+    }
+    m_cv.notify_all();
+
+    for (auto& t : m_threads) {
+        t.join();
+    }
+}
+
+/*
+ * Number of threads taking part in each loop, including the calling thread.
+ */
+inline auto ThreadPool::size() const -> std::size_t
+{
+    return m_threads.size() + 1;
+}
+
+/*
+ * Call fn(i) for all i in [0, n) across all threads of the pool, and wait
+ * until all calls have returned. Indices are handed out dynamically, one at a
+ * time, n must be less than 2^32.
+ */
+template<class F>
+void ThreadPool::run(std::size_t n, F&& fn)
+{
+    assert(n <= std::numeric_limits<u32>::max());
+
+    if (m_threads.empty() || n <= 1) {
+        for (std::size_t i = 0; i < n; ++i) {
+            fn(i);
+        }
+
+        return;
+    }
+
+    // all calls of the previous loop have returned, so no worker can claim an
+    // index before m_next is reset below
+    m_fn = [](void* ctx, std::size_t i) { (*static_cast<std::remove_reference_t<F>*>(ctx))(i); };
+    m_ctx = static_cast<void*>(&fn);
+    m_done.store(0, std::memory_order_relaxed);
+    m_next.store(static_cast<u64>(n) << 32, std::memory_order_release);
+
+    // publish the loop, only wake up parked workers if there are any
+    m_generation.fetch_add(1);
+
+    if (m_parked.load() > 0) {
+        // a worker may have checked the generation but not yet be waiting,
+        // taking the lock ensures that it does not miss the notification
+        {
+            auto const _l = std::lock_guard { m_lock };
+        }
+        m_cv.notify_all();
+    }
+
+    work();
+
+    // wait for the calls claimed by workers, yield eventually in case they
+    // are waiting for a core
+    for (unsigned i = 0; m_done.load(std::memory_order_acquire) < n; ++i) {
+        if (i < spin_yield) {
+            pause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void ThreadPool::pause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+inline void ThreadPool::worker()
+{
+    auto gen = u64 { 0 };
+
+    while (true) {
+        auto const start = std::chrono::steady_clock::now();
+        auto next = m_generation.load(std::memory_order_acquire);
+
+        // spin for a while, yield eventually in case the calling thread is
+        // waiting for a core
+        for (unsigned i = 1; next == gen; ++i) {
+            if (i < spin_yield) {
+                pause();
+            } else {
+                std::this_thread::yield();
+            }
+
+            if (i % 64 == 0 && std::chrono::steady_clock::now() - start > spin_time) {
+                break;
+            }
+
+            next = m_generation.load(std::memory_order_acquire);
+        }
+
+        // then park until the next loop
+        if (next == gen) {
+            auto lock = std::unique_lock { m_lock };
+
+            m_parked.fetch_add(1);
+            m_cv.wait(lock, [&]() { return m_generation.load() != gen; });
+            m_parked.fetch_sub(1);
+
+            next = m_generation.load();
+        }
+
+        gen = next;
+
+        if (m_stop.load()) {
+            return;
+        }
+
+        work();
+    }
+}
+
+/*
+ * Claim and run indices of the current loop until there are none left. A
+ * worker may get here late, after its loop has finished and the next one has
+ * started, in which case it simply takes part in that one.
+ */
+inline void ThreadPool::work()
+{
+    auto next = m_next.load(std::memory_order_acquire);
+    auto n_done = std::size_t { 0 };
+
+    while (true) {
+        auto const n = static_cast<std::size_t>(next >> 32);
+        auto const i = static_cast<std::size_t>(next & 0xffffffff);
+
+        if (i >= n) {
+            break;
+        }
+
+        // on failure, next is reloaded with the current value
+        if (!m_next.compare_exchange_weak(next, next + 1, std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+            continue;
+        }
+
+        m_fn(m_ctx, i);
+        ++n_done;
+
+        next = m_next.load(std::memory_order_acquire);
+    }
+
+    if (n_done > 0) {
+        m_done.fetch_add(n_done, std::memory_order_release);
+    }
+}
+
+} /* namespace iptsd::utils */